@@ -19,6 +19,13 @@ enum McmcKernelType
   MCMC_KERNEL_TRUNCATED_GAUSSIAN_INDEPENDENT_METROPOLIS,
   MCMC_KERNEL_GAUSSIAN_INDEPENDENT_METROPOLIS
 };
+/// Type of proposal (kernel) for the parameters
+/// if gradient information is used.
+enum McmcGradientKernelType 
+{ 
+  MCMC_GRADIENT_KERNEL_LANGEVIN = 0, // (preconditioned) Metropolis-adjusted Langevin algorithm
+  MCMC_GRADIENT_KERNEL_HAMILTONIAN   // (preconditioned) Hamiltonian Monte Carlo
+};
 
 /// Generic class for performing MCMC updates.
 template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class McmcParameters> class Mcmc
@@ -43,6 +50,9 @@ public:
     useAdaptiveProposalScaleFactor1_ = false;
     useDelayedAcceptance_ = false;
     isWithinSmcSampler_ = false;
+    gradientKernelType_ = MCMC_GRADIENT_KERNEL_LANGEVIN;
+    stepSize_ = 0.0;
+    nLeapfrogSteps_ = 10;
   }
   /// Constructor.
   Mcmc
@@ -69,6 +79,9 @@ public:
     proposalScale_ = 1.0;
     useAdaptiveProposalScaleFactor1_ = false;
     isWithinSmcSampler_ = false;
+    gradientKernelType_ = MCMC_GRADIENT_KERNEL_LANGEVIN;
+    stepSize_ = 0.0;
+    nLeapfrogSteps_ = 10;
   }
   
   /// Specifies the number of iterations
@@ -130,6 +143,81 @@ public:
   bool getUseDelayedAcceptance() {return useDelayedAcceptance_;}
   /// Returns whether or not the proposals use gradient information.
   bool getUseGradients() {return useGradients_;}
+  /// Specifies the type of gradient-based proposal kernel.
+  void setGradientKernelType(const McmcGradientKernelType gradientKernelType) {gradientKernelType_ = gradientKernelType;}
+  /// Returns the type of gradient-based proposal kernel.
+  McmcGradientKernelType getGradientKernelType() const {return gradientKernelType_;}
+  /// Specifies the step size of the gradient-based kernels (a non-positive
+  /// value means that the step size is chosen according to the usual 
+  /// scaling with the dimension of the parameter vector).
+  void setStepSize(const double stepSize) {stepSize_ = stepSize;}
+  /// Returns the step size of the gradient-based kernels.
+  double getStepSize() const
+  {
+    if (stepSize_ > 0)
+    {
+      return stepSize_;
+    }
+    else if (gradientKernelType_ == MCMC_GRADIENT_KERNEL_HAMILTONIAN)
+    {
+      return std::pow(static_cast<double>(preconditioner_.n_rows), -0.25);
+    }
+    else
+    {
+      return 1.65 * std::pow(static_cast<double>(preconditioner_.n_rows), -1.0/6.0);
+    }
+  }
+  /// Specifies the number of leapfrog steps of the Hamiltonian Monte Carlo kernel.
+  void setNLeapfrogSteps(const unsigned int nLeapfrogSteps) {nLeapfrogSteps_ = std::max(nLeapfrogSteps, 1u);}
+  /// Returns the number of leapfrog steps of the Hamiltonian Monte Carlo kernel.
+  unsigned int getNLeapfrogSteps() const {return nLeapfrogSteps_;}
+  /// Specifies the preconditioning matrix (e.g. an estimate of the posterior
+  /// covariance matrix) used by the gradient-based kernels.
+  void setPreconditioner(const arma::mat& preconditioner)
+  {
+    preconditioner_ = preconditioner;
+    preconditionerChol_ = arma::chol(preconditioner, "lower");
+  }
+  /// Samples the set of parameters from the preconditioned MALA proposal 
+  /// kernel given the gradient of the log-target density at thetaOld.
+  void proposeThetaLangevin(arma::colvec& thetaNew, const arma::colvec& thetaOld, const arma::colvec& gradient)
+  {
+    double stepSize = getStepSize();
+    thetaNew = thetaOld + 0.5 * stepSize * stepSize * preconditioner_ * gradient + 
+      stepSize * preconditionerChol_ * arma::randn<arma::colvec>(thetaOld.size());
+  }
+  /// Evaluates the log-density of the preconditioned MALA proposal kernel
+  /// (up to a constant which cancels in the acceptance ratio).
+  double evaluateLogProposalDensityLangevin(const arma::colvec& thetaNew, const arma::colvec& thetaOld, const arma::colvec& gradient)
+  {
+    double stepSize = getStepSize();
+    arma::colvec z = arma::solve(arma::trimatl(preconditionerChol_), 
+      thetaNew - thetaOld - 0.5 * stepSize * stepSize * preconditioner_ * gradient) / stepSize;
+    return - 0.5 * arma::dot(z, z);
+  }
+  /// Samples the momentum for the preconditioned Hamiltonian Monte Carlo 
+  /// kernel, i.e. from a Gaussian distribution whose covariance matrix is 
+  /// the inverse of the preconditioner.
+  void sampleMomentum(arma::colvec& momentum)
+  {
+    momentum = arma::solve(arma::trimatu(preconditionerChol_.t()), arma::randn<arma::colvec>(preconditioner_.n_rows));
+  }
+  /// Evaluates the kinetic energy of the preconditioned Hamiltonian Monte Carlo kernel.
+  double evaluateKineticEnergy(const arma::colvec& momentum)
+  {
+    arma::colvec z = preconditionerChol_.t() * momentum;
+    return 0.5 * arma::dot(z, z);
+  }
+  /// Performs a (fractional) momentum update within the leapfrog integrator.
+  void updateMomentum(arma::colvec& momentum, const arma::colvec& gradient, const double fraction)
+  {
+    momentum += fraction * getStepSize() * gradient;
+  }
+  /// Performs a position update within the leapfrog integrator.
+  void updatePosition(arma::colvec& theta, const arma::colvec& momentum)
+  {
+    theta += getStepSize() * preconditioner_ * momentum;
+  }
   /// Specifies the vector of RWMH proposal scales.
   void setRwmhSd(const arma::colvec& rwmhSd) {rwmhSd_ = rwmhSd;}
   /// Specifies whether the proposal scale (i.e. the scalar by which the sample covariance matrix is multiplied)
@@ -245,6 +333,11 @@ private:
   unsigned int nNonAdaptSamples_; // total number of samples before adaptation takes place
   
   bool useGradients_; // are we using gradient information in the proposals?
+  McmcGradientKernelType gradientKernelType_; // type of gradient-based proposal kernel
+  double stepSize_; // step size of the gradient-based kernels
+  unsigned int nLeapfrogSteps_; // number of leapfrog steps for Hamiltonian Monte Carlo kernels
+  arma::mat preconditioner_; // preconditioning matrix for the gradient-based kernels
+  arma::mat preconditionerChol_; // lower-triangular Cholesky factor of the preconditioning matrix
   bool useAdaptiveProposal_; // should we use the mixture proposal from Peters et al. (2010)?
   bool useAdaptiveProposalScaleFactor1_; // should we adapt proposalScaleFactor1_ if the accaptance rate is too high/low?
   bool useDelayedAcceptance_; // should we use delayed acceptance kernels?
@@ -284,7 +377,7 @@ void Mcmc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
   {
     thetaNew(k) = gaussian::rtnorm(model_.getSupportMin(k), model_.getSupportMax(k), 
                          thetaOld(k) + pow(proposalScale_ * rwmhSd_(k), 2.0) * gradient(k)/gradientL2Norm / 2.0, 
-                         proposalScale_ * rwmhSd_(k));
+                         proposalScale_ * rwmhSd_(k), true);
   }
 }
 /// Samples the set of parameters from the proposal kernel.
@@ -301,7 +394,7 @@ void Mcmc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
   {
 //     std::cout << "supportMin: " << model_.getSupportMin(k) << " supportMax: " << model_.getSupportMax(k) << " sd: " << proposalScale_ * rwmhSd_(k) << std::endl;
     thetaNew(k) = gaussian::rtnorm(model_.getSupportMin(k), model_.getSupportMax(k), 
-                         thetaOld(k), proposalScale_ * rwmhSd_(k));
+                         thetaOld(k), proposalScale_ * rwmhSd_(k), true);
   
   }
 }
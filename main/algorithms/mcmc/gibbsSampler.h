@@ -14,6 +14,8 @@
 #include "main/algorithms/smc/Smc.h"
 // #include "main/ehmm/Ehmm.h" // TODO: this file should not depend on Ehmm.h!
 #include "main/algorithms/mwg/Mwg.h"
+#include "main/helperFunctions/mcmcDiagnostics.h"
+#include <functional>
 
 /// Type of Monte Carlo algorithm used to sample the latent states
 enum SamplerType 
@@ -34,7 +36,7 @@ enum MarginalisationType
 
 /// Class for running the Gibbs samplers or 
 /// Metropolis-within-Gibbs algorithms.
-template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> GibbsSampler
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> class GibbsSampler
 {
 public:
   
@@ -58,6 +60,8 @@ public:
     marginalisationType_ = MARGINALISATION_NONE;
     nonCentringProbability_ = 0.0;
     nCores_ = 1;
+    nStored_ = 0;
+    nAdditionalPaths_ = 0;
   }
   
   /// Specifies the type of algorithm to be used to update
@@ -85,6 +89,11 @@ public:
   /// Specifies the vector of standard deviations of the uncorrelated Gaussian
   /// random-walk proposals for the full set of model parameters.
   void setProposalScalesMarginalised(const arma::colvec& proposalScalesMarginalised) {proposalScalesMarginalised_ = proposalScalesMarginalised;}
+  /// Specifies the number of additional paths selected from the particle 
+  /// system at each conditional SMC update. The stored output is then 
+  /// averaged over the new reference path and these additional paths 
+  /// (Rao--Blackwellisation); the parameter updates only use the reference path.
+  void setNAdditionalPaths(const unsigned int nAdditionalPaths) {nAdditionalPaths_ = nAdditionalPaths;}
   /// Runs the Gibbs sampler for some vector of initial parameter values
   /// "thetaInit" and returns the vector "output", each of which stores
   /// parameter values and potentially some other quantities generated at
@@ -93,11 +102,17 @@ public:
   {
     runSamplerBase(output, thetaInit);
   }
+  /// Initialises the Gibbs sampler at the parameter values "thetaInit" and 
+  /// stores the initial state as the first element of "output".
+  void initialiseSampler(std::vector<arma::colvec>& output, const arma::colvec& thetaInit);
+  /// Runs another nIterations iterations of the Gibbs sampler starting 
+  /// from its current state and appends them to "output".
+  void continueSampler(std::vector<arma::colvec>& output, const unsigned int nIterations);
 
 private:
   
   /// Runs the Gibbs sampler.
-  void runSamplerBase(std::vector<arma::colvec>& output); 
+  void runSamplerBase(std::vector<arma::colvec>& output, const arma::colvec& thetaInit); 
   /// Evaluates the log of the complete likelihood, i.e. including
   /// the log-conditional prior density of the latent variables.
   double evaluateLogCompleteLikelihood(const arma::colvec& theta, const LatentPath& latentPath, const bool includeLatentPriorDensity);
@@ -112,14 +127,12 @@ private:
   /// Samples parameters which had been analytically integrated out during the 
   /// parameter-update steps from their full conditional posterior distribution.
   void sampleMarginalisedParameters(arma::colvec& theta, const LatentPath& latentPath);
-  /// Proposes a new vector of parameter values
-  void proposeTheta(arma::colvec& thetaProp, const arma::colvec& theta);
   /// Computes part of the log of the Metropolis--Hastings acceptance probability
   /// (the ratio of the priors and proposal densities) needed for the parameter updates.
   double computeLogAlpha(const arma::colvec& thetaProp, const arma::colvec& theta)
   {
     // NOTE: we are using a multivariate Gaussian random-walk (i.e. symmetric) proposal here!
-    model_.evaluateLogPriorDensity(thetaProp) - model_.evaluateLogPriorDensity(theta);
+    return model_.evaluateLogPriorDensity(thetaProp) - model_.evaluateLogPriorDensity(theta);
   }
   /// Proposes a new vector of parameter values.
   void proposeTheta(arma::colvec& thetaProp, const arma::colvec& theta)
@@ -142,7 +155,7 @@ private:
 
     double logCompleteLikelihood, logCompleteLikelihoodProp; // log of the complete likelihoods
     double logAlpha; // (part of the) log-acceptance probability for the Metropolis--Hastings parameter updates
-    arma::colvec thetaProp(theta.size); // vector of newly-proposed model parameters
+    arma::colvec thetaProp(theta.size()); // vector of newly-proposed model parameters
     
     if (arma::randu() < nonCentringProbability_) // i.e. update the model parameters using the NCP
     {
@@ -208,8 +221,20 @@ private:
   void initialiseOutput(std::vector<arma::colvec>& output);
   /// Stores output.
   void storeOutput(const unsigned int g, std::vector<arma::colvec>& output, const arma::colvec& theta, const LatentPath& latentPath);
+  /// Averages the gth output over the reference path and the additional 
+  /// paths selected at the last conditional SMC update.
+  void averageOutputOverAdditionalPaths(const unsigned int g, std::vector<arma::colvec>& output, const arma::colvec& theta)
+  {
+    std::vector<arma::colvec> outputAux(1);
+    for (unsigned int m=0; m<additionalLatentPaths_.size(); m++)
+    {
+      storeOutput(0, outputAux, theta, additionalLatentPaths_[m]);
+      output[g] += outputAux[0];
+    }
+    output[g] /= additionalLatentPaths_.size() + 1.0;
+  }
   /// Updates the latent variables.
-  void upateLatentVariables(const arma::colvec& theta, LatentPath& latentPath)
+  void updateLatentVariables(const arma::colvec& theta, LatentPath& latentPath)
   {
     if (samplerType_ == SAMPLER_MWG)
     {    
@@ -217,7 +242,14 @@ private:
     }
     else if (samplerType_ == SAMPLER_SMC)
     {
-      smc_.runConditionalSampler(theta, latentPath);
+      if (nAdditionalPaths_ > 0)
+      {
+        smc_.runConditionalSampler(theta, latentPath, additionalLatentPaths_);
+      }
+      else
+      {
+        smc_.runConditionalSampler(theta, latentPath);
+      }
     }
     else if (samplerType_ == SAMPLER_EHMM)
     {
@@ -227,9 +259,9 @@ private:
   
   Rng& rng_; // random number generation.
   Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>& model_; // the targeted model.
-  Mwg<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, MwgParameters>& mwg_, // TODO: the Metropolis-within-Gibbs updates
-  Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, SmcParameters>& smc_, // the SMC updates
-  Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, EhmmParameters>& ehmm_, // TODO: the embedded HMM updates
+  Mwg<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, MwgParameters>& mwg_; // TODO: the Metropolis-within-Gibbs updates
+  Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, SmcParameters>& smc_; // the SMC updates
+  Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, EhmmParameters>& ehmm_; // TODO: the embedded HMM updates
   SamplerType samplerType_; // type of algorithm used for updating the latent variables
   MarginalisationType marginalisationType_; // should certain model parameters (for which this is possible) be integrated out analytically when updating the latent variables?
   
@@ -240,18 +272,32 @@ private:
   double nonCentringProbability_; // probability of using the non-centred parameterisation when updating the model parameters
   unsigned int nCores_; // number of cores (this parameter is currently not used)
   
-}
+  arma::colvec theta_; // current parameter values (needed for continuing the sampler)
+  LatentPath latentPath_; // current latent variables (needed for continuing the sampler)
+  unsigned int nStored_; // number of iterations stored in the output so far
+  unsigned int nAdditionalPaths_; // number of additional paths selected at each conditional SMC update
+  std::vector<LatentPath> additionalLatentPaths_; // additional paths (only used for Rao--Blackwellising the output)
+  
+};
 
 /// Runs the Gibbs sampler.
-template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters,  class EhmmParameters> void GibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, SmcParameters, EhmmParameters, MwgParameters>::runSamplerBase
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> void GibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, MwgParameters, SmcParameters, EhmmParameters>::runSamplerBase
+(
+  std::vector<arma::colvec>& output, // static parameters and other output to be stored
+  const arma::colvec& thetaInit // initial parameter values
+)
+{
+  initialiseSampler(output, thetaInit);
+  continueSampler(output, nIterations_ - 1);
+}
+/// Initialises the Gibbs sampler.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> void GibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, MwgParameters, SmcParameters, EhmmParameters>::initialiseSampler
 (
   std::vector<arma::colvec>& output, // static parameters and other output to be stored
   const arma::colvec& thetaInit // initial parameter values
 )
 {
- 
-  LatentPath latentPath; // latent variables under the standard parametrisation
-  arma::colvec theta = thetaInit; // vector of model parameters
+  theta_ = thetaInit; // vector of model parameters
 
   // Initialisation
   /////////////////////////////////////////////////////////////////////////////
@@ -265,16 +311,39 @@ template <class ModelParameters, class LatentVariable, class LatentPath, class L
     model_.setMarginaliseParameters(false);
   }
   
-  initialiseLatentVariables(theta, latentPath);
+  initialiseLatentVariables(theta_, latentPath_);
+  
+  additionalLatentPaths_.resize(samplerType_ == SAMPLER_SMC ? nAdditionalPaths_ : 0);
+  for (unsigned int m=0; m<additionalLatentPaths_.size(); m++)
+  {
+    initialiseLatentPath(theta_, additionalLatentPaths_[m]);
+  }
   
   // Initialise and store output:
   initialiseOutput(output);
-  storeOutput(0, output, theta, latentPath);
+  if (output.size() < 1) 
+  {
+    output.resize(1);
+  }
+  storeOutput(0, output, theta_, latentPath_);
+  nStored_ = 1;
+}
+/// Continues running the Gibbs sampler from its current state.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> void GibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, MwgParameters, SmcParameters, EhmmParameters>::continueSampler
+(
+  std::vector<arma::colvec>& output, // static parameters and other output to be stored
+  const unsigned int nIterations // number of additional iterations
+)
+{
+  if (output.size() < nStored_ + nIterations)
+  {
+    output.resize(nStored_ + nIterations);
+  }
   
   // Recursion
   /////////////////////////////////////////////////////////////////////////////
   
-  for (unsigned int g=1; g<nIterations; g++)
+  for (unsigned int g=nStored_; g<nStored_+nIterations; g++)
   {
     
     if (marginalisationType_ == MARGINALISATION_FULL)
@@ -287,7 +356,7 @@ template <class ModelParameters, class LatentVariable, class LatentPath, class L
     }
     
     /// Update the latent variables
-    updateLatentVariables(theta, latentPath);
+    updateLatentVariables(theta_, latentPath_);
     
     
     if (estimateTheta_) // i.e. unless we fix the model parameters
@@ -301,17 +370,154 @@ template <class ModelParameters, class LatentVariable, class LatentPath, class L
         model_.setMarginaliseParameters(false);
       }
       // Update the model parameters
-      updateParameters(theta, latentPath)
+      updateParameters(theta_, latentPath_);
       
       // Sample the parameters from their full conditional posterior distribution
       // for which this full conditional distribution is available.
-      sampleMarginalisedParameters(theta, latentPath);
+      sampleMarginalisedParameters(theta_, latentPath_);
     }
    
     // Store output:
-    storeOutput(g, output, theta, latentPath);
+    storeOutput(g, output, theta_, latentPath_);
+    if (!additionalLatentPaths_.empty())
+    {
+      averageOutputOverAdditionalPaths(g, output, theta_);
+    }
+
+  }
+  nStored_ += nIterations;
+}
 
+/// Class for running several independent Gibbs samplers (in rounds of
+/// nIterationsPerRound iterations) until the (pooled) effective sample size 
+/// of each component of the stored output (i.e. the parameters and any 
+/// latent-variable summaries stored by storeOutput()) reaches some target. 
+/// Each Gibbs sampler must hold references to its own model, Mwg, Smc and 
+/// Ehmm classes. This is a sequential driver: within each round, the chains
+/// are run one after another because the samplers draw their random numbers 
+/// from R's (global) generator via arma::randu/randn.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> class MultiChainGibbsSampler
+{
+public:
+  
+  /// Initialises the class.
+  MultiChainGibbsSampler
+  (
+    const std::vector<std::reference_wrapper<GibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, MwgParameters, SmcParameters, EhmmParameters>>>& samplers
+  ) :
+    samplers_(samplers)
+  {
+    targetEss_ = 1000.0;
+    nBurninIterations_ = 100;
+    nIterationsPerRound_ = 100;
+    nIterationsMax_ = 100000;
+  }
+  
+  /// Specifies the (pooled) effective sample size targeted for each component of the output.
+  void setTargetEss(const double targetEss) {targetEss_ = targetEss;}
+  /// Specifies the number of burn-in iterations discarded from each chain.
+  void setNBurninIterations(const unsigned int nBurninIterations) {nBurninIterations_ = nBurninIterations;}
+  /// Specifies the number of iterations run by each chain in between two 
+  /// checks of the convergence diagnostics.
+  void setNIterationsPerRound(const unsigned int nIterationsPerRound) {nIterationsPerRound_ = std::max(nIterationsPerRound, 1u);}
+  /// Specifies the maximum number of iterations (including burn-in) per chain.
+  void setNIterationsMax(const unsigned int nIterationsMax) {nIterationsMax_ = nIterationsMax;}
+  /// Returns the number of iterations (including burn-in) run by each chain.
+  unsigned int getNIterations() const {return nIterations_;}
+  /// Returns the potential scale reduction factor for each component of the output.
+  arma::colvec getRhat() const {return rHat_;}
+  /// Returns the (pooled) effective sample size for each component of the output.
+  arma::colvec getEss() const {return ess_;}
+  /// Returns the post-burn-in output of all chains (concatenated).
+  void getPooledOutput(std::vector<arma::colvec>& pooledOutput) const
+  {
+    pooledOutput.clear();
+    for (unsigned int c=0; c<output_.size(); c++)
+    {
+      pooledOutput.insert(pooledOutput.end(), output_[c].begin() + std::min(nBurninIterations_, nIterations_), output_[c].begin() + nIterations_);
+    }
+  }
+  /// Returns the full output of each chain.
+  void getOutput(std::vector<std::vector<arma::colvec>>& output) const {output = output_;}
+  /// Runs the Gibbs samplers, where the cth chain is initialised 
+  /// at thetaInit[c].
+  void runSampler(const std::vector<arma::colvec>& thetaInit);
+  
+private:
+  
+  /// Computes the convergence diagnostics from the post-burn-in output.
+  void computeDiagnostics();
+  
+  std::vector<std::reference_wrapper<GibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, MwgParameters, SmcParameters, EhmmParameters>>> samplers_; // the individual chains
+  std::vector<std::vector<arma::colvec>> output_; // output of each chain
+  double targetEss_; // targeted (pooled) effective sample size
+  unsigned int nBurninIterations_; // number of burn-in iterations per chain
+  unsigned int nIterationsPerRound_; // number of iterations per chain in between two convergence checks
+  unsigned int nIterationsMax_; // maximum number of iterations per chain
+  unsigned int nIterations_; // number of iterations run by each chain
+  arma::colvec rHat_; // potential scale reduction factors
+  arma::colvec ess_; // (pooled) effective sample sizes
+  
+};
+
+/// Runs the Gibbs samplers.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> void MultiChainGibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, MwgParameters, SmcParameters, EhmmParameters>::runSampler
+(
+  const std::vector<arma::colvec>& thetaInit // initial parameter values for each chain
+)
+{
+  const unsigned int nChains = samplers_.size();
+  output_.resize(nChains);
+  
+  for (unsigned int c=0; c<nChains; c++)
+  {
+    samplers_[c].get().initialiseSampler(output_[c], thetaInit[c]);
+  }
+  nIterations_ = 1;
+  
+  while (nIterations_ < nIterationsMax_)
+  {
+    const unsigned int nIterationsRound = std::min(nIterationsPerRound_, nIterationsMax_ - nIterations_);
+    
+    for (unsigned int c=0; c<nChains; c++)
+    {
+      samplers_[c].get().continueSampler(output_[c], nIterationsRound);
+    }
+    nIterations_ += nIterationsRound;
+    
+    if (nIterations_ >= nBurninIterations_ + 4)
+    {
+      computeDiagnostics();
+      std::cout << "Iteration " << nIterations_ << " of the multi-chain Gibbs sampler: min. ESS: " << ess_.min() << "; max. R-hat: " << rHat_.max() << std::endl;
+      if (ess_.min() >= targetEss_)
+      {
+        return;
+      }
+    }
+  }
+  if (nIterations_ >= nBurninIterations_ + 4)
+  {
+    std::cout << "WARNING: maximum number of iterations reached before attaining the target ESS!" << std::endl;
+  }
+}
+/// Computes the convergence diagnostics.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class MwgParameters, class SmcParameters, class EhmmParameters> void MultiChainGibbsSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, MwgParameters, SmcParameters, EhmmParameters>::computeDiagnostics()
+{
+  const unsigned int nChains = output_.size();
+  const unsigned int nKept = nIterations_ - nBurninIterations_;
+  const unsigned int dim = output_[0][0].size();
+  
+  std::vector<arma::mat> chains(nChains);
+  for (unsigned int c=0; c<nChains; c++)
+  {
+    chains[c].set_size(dim, nKept);
+    for (unsigned int g=0; g<nKept; g++)
+    {
+      chains[c].col(g) = output_[c][nBurninIterations_ + g];
+    }
   }
+  rHat_ = mcmcDiagnostics::computeRhat(chains);
+  ess_  = mcmcDiagnostics::computeEss(chains);
 }
 
 #endif
@@ -15,6 +15,119 @@
 #include "main/algorithms/smc/default/single.h"
 #include "time.h"
 
+///////////////////////////////////////////////////////////////////////////////
+/// Calibration of the number of particles for PMMH algorithms
+///////////////////////////////////////////////////////////////////////////////
+
+/// Returns the (approximate) integrated autocorrelation time of a PMMH chain
+/// as a function of the standard deviation sigma of the difference of the 
+/// log-likelihood estimates at the current and proposed values divided by 
+/// sqrt(2). It uses the perfect-proposal approximation from Pitt, dos Santos 
+/// Silva, Giordani & Kohn (2012), i.e. IF = (1 + r)/(1 - r), where 
+/// r = 1 - 2 Phi(-sigma/sqrt(2)) is the rejection probability.
+double evaluatePmmhInefficiency(const double sigma)
+{
+  double acceptanceRate = 2.0 * R::pnorm(- sigma / std::sqrt(2.0), 0.0, 1.0, true, false);
+  return (2.0 - acceptanceRate) / acceptanceRate;
+}
+
+/// Calibrates the number of particles used by the PMMH algorithm and sets
+/// it in the SMC class. The variance of the log-likelihood estimator at
+/// thetaPilot is estimated from nReplicates independent runs of the SMC
+/// algorithm with nParticlesPilot particles and modelled as c/N. If 
+/// correlationParameter > 0 and the Gaussian parametrisation is used, then 
+/// the correlation between consecutive log-likelihood estimates under the 
+/// correlated pseudo-marginal approach is also estimated so that only the 
+/// variance of their difference enters. The returned number of particles 
+/// minimises the computing time (assumed to be linear in N) per effective 
+/// sample.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class SmcParameters>
+unsigned int calibratePmmhNParticles
+(
+  Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>& model, 
+  Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, SmcParameters>& smc, 
+  const arma::colvec& thetaPilot,
+  const unsigned int nParticlesPilot,
+  const unsigned int nReplicates,
+  const double correlationParameter = 0.0,
+  const unsigned int nParticlesMin = 10,
+  const unsigned int nParticlesMax = 100000
+)
+{
+  clock_t t1,t2; // timing
+  LatentPath latentPath;
+  AuxFull<Aux> aux;
+  arma::colvec logLikelihoods(nReplicates);
+  arma::colvec logLikelihoodsCorrelated(nReplicates);
+  
+  const bool useCorrelated = correlationParameter > 0 && smc.getUseGaussianParametrisation();
+  const bool determineParticlesFromGaussians = smc.getDetermineParticlesFromGaussians();
+  
+  t1 = clock(); // start timer
+  for (unsigned int i=0; i<nReplicates; i++)
+  {
+    if (useCorrelated)
+    {
+      smc.setDetermineParticlesFromGaussians(false);
+      logLikelihoods(i) = smc.runSmc(nParticlesPilot, thetaPilot, latentPath, aux, 1.0);
+      aux.addCorrelatedGaussianNoise(correlationParameter);
+      smc.setDetermineParticlesFromGaussians(true);
+      logLikelihoodsCorrelated(i) = smc.runSmc(nParticlesPilot, thetaPilot, latentPath, aux, 1.0);
+    }
+    else
+    {
+      logLikelihoods(i) = smc.runSmc(nParticlesPilot, thetaPilot, latentPath, aux, 1.0);
+    }
+  }
+  t2 = clock(); // stop timer 
+  smc.setDetermineParticlesFromGaussians(determineParticlesFromGaussians);
+  
+  double nRuns = useCorrelated ? 2.0 * nReplicates : nReplicates;
+  double cpuTimePerParticle = (static_cast<double>(t2)-static_cast<double>(t1)) / CLOCKS_PER_SEC / (nRuns * nParticlesPilot);
+  
+  // Variance of the log-likelihood estimator times the number of particles:
+  double varianceScale = nParticlesPilot * arma::var(logLikelihoods);
+  if (useCorrelated)
+  {
+    double correlation = arma::as_scalar(arma::cor(logLikelihoods, logLikelihoodsCorrelated));
+    std::cout << "Estimated correlation of the log-likelihood estimates: " << correlation << std::endl;
+    varianceScale *= std::max(1.0 - correlation, 0.0);
+  }
+  std::cout << "Estimated standard deviation of the log-likelihood estimator at the pilot value: " << std::sqrt(varianceScale / nParticlesPilot) << std::endl;
+  
+  // Computing time per effective sample, i.e. N * IF(sigma(N)), is 
+  // proportional to IF(sigma)/sigma^2 because sigma^2 = c/N:
+  double sigma, sigmaOpt = 1.0;
+  double cost, costOpt = std::numeric_limits<double>::infinity();
+  for (unsigned int k=1; k<=500; k++)
+  {
+    sigma = 0.01 * k;
+    cost = evaluatePmmhInefficiency(sigma) / (sigma * sigma);
+    if (cost < costOpt)
+    {
+      costOpt = cost;
+      sigmaOpt = sigma;
+    }
+  }
+  
+  unsigned int nParticles;
+  if (std::isfinite(varianceScale))
+  {
+    double nParticlesOpt = std::ceil(varianceScale / (sigmaOpt * sigmaOpt));
+    nParticles = static_cast<unsigned int>(std::min(std::max(nParticlesOpt, static_cast<double>(nParticlesMin)), static_cast<double>(nParticlesMax)));
+  }
+  else
+  {
+    std::cout << "WARNING: non-finite log-likelihood estimates during calibration; using the maximum number of particles!" << std::endl;
+    nParticles = nParticlesMax;
+  }
+  std::cout << "Calibrated number of particles: " << nParticles << " (predicted CPU time per effective sample: " 
+            << cpuTimePerParticle * nParticles * evaluatePmmhInefficiency(std::sqrt(varianceScale / nParticles)) << " sec.)" << std::endl;
+  
+  smc.setNParticles(nParticles);
+  return nParticles;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// PMMH algorithm potentially with delayed acceptance
 ///////////////////////////////////////////////////////////////////////////////
@@ -34,7 +147,8 @@ void runPmmh
   Mcmc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, McmcParameters>& mcmc, 
   const arma::colvec& thetaInit,
   const bool samplePath, // should one trajectory of the latent variables/particles be stored at each iteration?
-  const unsigned int nCores
+  const unsigned int nCores,
+  const unsigned int nCalibrationReplicates = 0 // number of pilot runs for calibrating the number of particles (no calibration if 0)
 )
 {
     
@@ -42,6 +156,19 @@ void runPmmh
   clock_t t1,t2; // timing
   t1 = clock(); // start timer
   
+  if (nCalibrationReplicates > 1)
+  {
+    // Crank--Nicolson correlation of the auxiliary variables at the pilot 
+    // number of particles (only used if the Gaussian parametrisation is used, 
+    // i.e. under the correlated pseudo-marginal approach):
+    double correlationParameter = 0.0;
+    if (smc.getUseGaussianParametrisation())
+    {
+      correlationParameter = mcmc.getCrankNicolsonScale(smc.getNParticles(), static_cast<unsigned int>(model.getNObservations()));
+    }
+    calibratePmmhNParticles(model, smc, thetaInit, smc.getNParticles(), nCalibrationReplicates, correlationParameter);
+  }
+  
   // TODO: implement support for use of gradient information
   LatentPath latentPathProp, latentPath;
   AuxFull<Aux> aux; // TODO: implement support for correlated psuedo-marginal approaches
@@ -127,6 +127,49 @@ private:
   
 };
 
+/// Holds the buffers needed by a single run of an SMC algorithm so that
+/// these can be reused across repeated runs (e.g. within PMMH, SMC 
+/// samplers or SAME) instead of being reallocated at each call. The 
+/// std::vector buffers never release their capacity and assigning a 
+/// particle to an existing particle of the same size (e.g. arma::colvec) 
+/// overwrites its memory in place.
+template<class Particle> class SmcWorkspace
+{
+public:
+  
+  /// Initialises the class.
+  SmcWorkspace() {}
+  /// Destructor.
+  ~SmcWorkspace() {}
+  
+  /// Makes sure that all buffers are of the right size for a 
+  /// specific number of particles.
+  void resize(const unsigned int nParticles)
+  {
+    particlesNew_.resize(nParticles);
+    particlesOld_.resize(nParticles);
+    parentIndices_.set_size(nParticles);
+    logUnnormalisedWeights_.set_size(nParticles);
+    selfNormalisedWeights_.set_size(nParticles);
+    logIncrementalWeights_.set_size(nParticles);
+  }
+  
+  /// Particles from the current step.
+  std::vector<Particle> particlesNew_;
+  /// Particles from the previous step (after resampling).
+  std::vector<Particle> particlesOld_;
+  /// Parent indices associated with a single SMC step.
+  arma::uvec parentIndices_;
+  /// Unnormalised log-weights associated with a single SMC step.
+  arma::colvec logUnnormalisedWeights_;
+  /// Self-normalised weights associated with a single SMC step.
+  arma::colvec selfNormalisedWeights_;
+  /// Scratch buffer for the incremental log-weights (e.g. the batch
+  /// log-observation densities) computed by the model-specific members.
+  arma::colvec logIncrementalWeights_;
+  
+};
+
 /// Class template for running (conditional) SMC algorithms or other forms 
 /// of importance sampling.
 template<class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class SmcParameters> class Smc
@@ -160,6 +203,9 @@ public:
     samplePath_   = true; // TODO: make this accessible from the outside
     resampleType_ = SMC_RESAMPLE_SYSTEMATIC;
 //     weightsContainNans_ = false;
+    earlyRejectionThreshold_ = - std::numeric_limits<double>::infinity();
+    maxLogLikelihoodIncrement_ = std::numeric_limits<double>::infinity();
+    isEarlyRejected_ = false;
   }
   
   /// Initialises the class without specifying many of the parameters.
@@ -184,6 +230,9 @@ public:
     samplePath_   = true;
 //     weightsContainNans_ = false;
     resampleType_ = SMC_RESAMPLE_SYSTEMATIC;
+    earlyRejectionThreshold_ = - std::numeric_limits<double>::infinity();
+    maxLogLikelihoodIncrement_ = std::numeric_limits<double>::infinity();
+    isEarlyRejected_ = false;
   }
   
   /// Returns the SMC parameters.
@@ -234,6 +283,17 @@ public:
   {
     determineParticlesFromGaussians_ = determineParticlesFromGaussians;
   }
+  /// Specifies the value which the log-likelihood estimate must exceed; 
+  /// the (unconditional) SMC algorithm is aborted as soon as this is no 
+  /// longer possible. A value of minus infinity disables early rejection.
+  void setEarlyRejectionThreshold(const double earlyRejectionThreshold) {earlyRejectionThreshold_ = earlyRejectionThreshold;}
+  /// Specifies an upper bound on the incremental log-likelihood estimate
+  /// at each SMC step which is needed for early rejection. Any upper bound 
+  /// on the log-incremental particle weights can be used (e.g. zero for the 
+  /// bootstrap proposal if all observation densities are bounded by one).
+  void setMaxLogLikelihoodIncrement(const double maxLogLikelihoodIncrement) {maxLogLikelihoodIncrement_ = maxLogLikelihoodIncrement;}
+  /// Returns whether the last run of the SMC algorithm was aborted early.
+  bool getIsEarlyRejected() const {return isEarlyRejected_;}
   /// Should we generate one sample path at the end of the algorithm?
   void setSamplePath(const bool samplePath) {samplePath_ = samplePath;}
   /// Converts a particle path into the set of all latent variables in the model.
@@ -259,6 +319,24 @@ public:
     AuxFull<Aux>& auxFull,
     const double inverseTemperature
   );
+  /// Runs a conditional SMC algorithm which conditions on the reference 
+  /// path "latentPath" and overwrites it by a new path selected from the 
+  /// particle system. The elements of "additionalLatentPaths" are 
+  /// overwritten by further paths selected (conditionally independently) 
+  /// from the same particle system. NOTE: this is not a multiple-reference
+  /// conditional SMC algorithm: only "latentPath" is conditioned on (with 
+  /// ancestor sampling if enabled) and only it is a valid new state of the
+  /// CSMC kernel. The additional paths can be used for Rao--Blackwellised 
+  /// estimates but must not be used as reference paths in subsequent calls.
+  double runCsmc
+  (
+    const unsigned int nParticles, 
+    const arma::colvec& theta,
+    LatentPath& latentPath,
+    std::vector<LatentPath>& additionalLatentPaths,
+    AuxFull<Aux>& auxFull,
+    const double inverseTemperature
+  );
   /// Runs a conditional SMC algorithm but without selecting a new path.
   double runCsmcWithoutPathSampling
   (
@@ -307,7 +385,7 @@ public:
     isConditional_ = false;
     AuxFull<Aux> auxFull;
     runSmcBase(auxFull);
-    if (samplePath_)
+    if (samplePath_ && !isEarlyRejected_)
     {
       samplePath(latentPath);
     }
@@ -328,6 +406,26 @@ public:
       samplePath(latentPath);
     }
   };
+  /// Runs a conditional SMC algorithm and selects additional paths 
+  /// from the final particle system (see runCsmc()). The reference 
+  /// path for the next call remains "latentPath".
+  void runConditionalSampler
+  (
+    const arma::colvec& theta,
+    LatentPath& latentPath,
+    std::vector<LatentPath>& additionalLatentPaths
+  )
+  {
+    model_.setUnknownParameters(theta);
+    isConditional_ = true;
+    AuxFull<Aux> auxFull;
+    runSmcBase(auxFull);
+    if (samplePath_)
+    {
+      samplePath(latentPath);
+      sampleAdditionalPaths(additionalLatentPaths);
+    }
+  };
   /// Selects one particle path.
   void samplePath(LatentPath& latentPath)
   {
@@ -409,10 +507,29 @@ private:
   /// Computes (part of the) unnormalised "future" target density needed for backward
   /// or ancestor sampling.
   double logDensityUnnormalisedTarget(const unsigned int t, const Particle& particle);
-  /// Runs the SMC algorithm.
+  /// Runs the SMC algorithm. This is a thin wrapper which selects the 
+  /// (compile-time) resampling and ancestor-sampling schemes according to
+  /// the run-time settings.
   void runSmcBase(AuxFull<Aux>& aux);
+  /// Runs the SMC algorithm with the resampling scheme given by the
+  /// policy class Resampler and with or without ancestor sampling.
+  template <class Resampler, bool UseAncestorSampling> void runSmcBaseImpl(AuxFull<Aux>& aux);
   /// Samples one particle path from the particle system.
   void samplePathBase();
+  /// Selects further particle paths (conditionally independently) from the 
+  /// particle system without changing the reference path for the next 
+  /// conditional SMC run.
+  void sampleAdditionalPaths(std::vector<LatentPath>& additionalLatentPaths)
+  {
+    std::vector<Particle> referencePath = particlePath_;
+    arma::uvec referenceIndices = particleIndicesOut_;
+    for (unsigned int m=0; m<additionalLatentPaths.size(); m++)
+    {
+      samplePath(additionalLatentPaths[m]);
+    }
+    particlePath_ = referencePath;
+    particleIndicesOut_ = referenceIndices;
+  }
   /// Calculates smoothing estimate (at the moment: the gradient) via fixed-lag smoothing.
   void runFixedLagSmoothing(arma::colvec& gradientEstimate);
   /// Updates the gradient estimate for a particular SMC step.
@@ -441,12 +558,16 @@ private:
   unsigned int fixedLagSmoothingOrder_; // lag order used in fixed-lag smoothing.
   bool isConditional_; // are we using a conditional SMC algorithm?
   double logLikelihoodEstimate_; // estimate of the normalising constant.
+  double earlyRejectionThreshold_; // the algorithm is aborted once the log-likelihood estimate can no longer exceed this value
+  double maxLogLikelihoodIncrement_; // upper bound on the incremental log-likelihood estimate at each SMC step
+  bool isEarlyRejected_; // was the last run of the algorithm aborted early?
   std::vector<std::vector<Particle>> particlesFull_; // (nSteps_, nParticles_)-dimensional: holds all particles
   std::vector<Particle> particlePath_; // single particle path needed for conditional SMC algorithms
   arma::uvec particleIndicesIn_; // particle indices associated with the single input particle path
   arma::uvec particleIndicesOut_; // particle indices associated with the single output particle path
   arma::umat parentIndicesFull_; // (nParticles_, nSteps_)-dimensional: holds all parent indices
   arma::mat logUnnormalisedWeightsFull_; // (nParticles_, nSteps_)-dimensional: holds all log-unnormalised weight
+  SmcWorkspace<Particle> workspace_; // buffers reused across calls of runSmcBase()
   SmcParameters smcParameters_; // holds some additional auxiliary parameters for the SMC algorithm.
   unsigned int nCores_; // number of cores to use (not currently used)
   
@@ -458,6 +579,31 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
 (
   AuxFull<Aux>& auxFull
 )
+{
+  bool useAncestorSampling = (smcBackwardSamplingType_ == SMC_BACKWARD_SAMPLING_ANCESTOR);
+  
+  if (resampleType_ == SMC_RESAMPLE_MULTINOMIAL)
+  {
+    if (useAncestorSampling) {runSmcBaseImpl<resample::MultinomialPolicy, true>(auxFull);}
+    else {runSmcBaseImpl<resample::MultinomialPolicy, false>(auxFull);}
+  }
+  else 
+  {
+    if (resampleType_ != SMC_RESAMPLE_SYSTEMATIC)
+    {
+      std::cout << "WARNING: only multinomial and systematic resampling are implemented; using systematic resampling!" << std::endl;
+    }
+    if (useAncestorSampling) {runSmcBaseImpl<resample::SystematicPolicy, true>(auxFull);}
+    else {runSmcBaseImpl<resample::SystematicPolicy, false>(auxFull);}
+  }
+}
+/// Runs the SMC algorithm with compile-time resampling and ancestor-sampling schemes.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class SmcParameters>
+template <class Resampler, bool UseAncestorSampling>
+void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, SmcParameters>::runSmcBaseImpl
+(
+  AuxFull<Aux>& auxFull
+)
 {
   ///////////////////////////////
   ///////////////////////////////
@@ -474,18 +620,21 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
   double ess; // effective sample size
   double u; // single uniform random variable used for systematic resampling
   
-  arma::uvec parentIndices(nParticles_); // parent indices associated with a single SMC step
-  std::vector<Particle> particlesOld(nParticles_); // particles from current step
-  std::vector<Particle> particlesNew(nParticles_); // particles from previous step
+  // The buffers are owned by the workspace and reused across calls:
+  workspace_.resize(nParticles_);
+  arma::uvec& parentIndices = workspace_.parentIndices_; // parent indices associated with a single SMC step
+  std::vector<Particle>& particlesOld = workspace_.particlesOld_; // particles from previous step
+  std::vector<Particle>& particlesNew = workspace_.particlesNew_; // particles from current step
   
   unsigned int singleParentIndex   = 0; // parent index for a single particle
   unsigned int singleParticleIndex = 0; // particle index for a single particle 
   
-  arma::colvec logUnnormalisedWeights(nParticles_);    // unnormalised log-weights associated with a single SMC step
+  arma::colvec& logUnnormalisedWeights = workspace_.logUnnormalisedWeights_; // unnormalised log-weights associated with a single SMC step
   logUnnormalisedWeights.fill(-std::log(nParticles_)); // start with uniform weights
-  arma::colvec selfNormalisedWeights(nParticles_);     // normalised weights associated with a single SMC step
+  arma::colvec& selfNormalisedWeights = workspace_.selfNormalisedWeights_; // normalised weights associated with a single SMC step
   
   logLikelihoodEstimate_ = 0; // log of the estimated marginal likelihood   
+  isEarlyRejected_ = false;
   
   ///////////////////////////////////////////////////////////////////////////
   // Step 0 of the SMC algorithm
@@ -501,14 +650,7 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
   {
     storeHistory_ = true;
     particleIndicesIn_.set_size(nSteps_);
-    if (resampleType_ == SMC_RESAMPLE_SYSTEMATIC)
-    {
-      particleIndicesIn_(0) = arma::as_scalar(arma::randi(1, arma::distr_param(0,nParticles_-1)));
-    }
-    else if (resampleType_ == SMC_RESAMPLE_MULTINOMIAL) 
-    {
-      particleIndicesIn_(0) = 0;
-    }
+    particleIndicesIn_(0) = Resampler::sampleInitialReferenceIndex(nParticles_);
   }
   
   ///////////////////////////////
@@ -601,6 +743,21 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
 //     std::cout << "################# SMC, Step " << t << " #########################" <<std::endl; 
 // if (isConditional_) {std::cout << particlePath_[t] << std::endl;}
     
+    ///////////////////////////////////////////////////////////////////////////
+    // Early rejection
+    ///////////////////////////////////////////////////////////////////////////
+    
+    // The remaining nSteps_ - t incremental log-likelihood estimates 
+    // cannot exceed maxLogLikelihoodIncrement_ each.
+    if (!isConditional_ && 
+        logLikelihoodEstimate_ + std::log(arma::accu(arma::exp(logUnnormalisedWeights))) + 
+        (nSteps_ - t) * maxLogLikelihoodIncrement_ < earlyRejectionThreshold_)
+    {
+      logLikelihoodEstimate_ = - std::numeric_limits<double>::infinity();
+      isEarlyRejected_ = true;
+      return;
+    }
+    
     ///////////////////////////////////////////////////////////////////////////
     // Ancestor sampling
     ///////////////////////////////////////////////////////////////////////////
@@ -608,7 +765,7 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
     if (isConditional_) // i.e. if we run a conditional SMC algorithm 
     {
       // Determining the parent index of the current input particle:
-      if (smcBackwardSamplingType_ == SMC_BACKWARD_SAMPLING_ANCESTOR) // via ancestor sampling
+      if (UseAncestorSampling) // via ancestor sampling
       {
         singleParentIndex = backwardSampling(t-1, logUnnormalisedWeights, particlesFull_[t-1]);
       }
@@ -635,8 +792,9 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
   ///////////////////////////////
     
     
-    // self-normalised weights:
-    selfNormalisedWeights = normaliseWeights(logUnnormalisedWeights);
+    // self-normalised weights (computed in place):
+    selfNormalisedWeights = arma::exp(logUnnormalisedWeights - logUnnormalisedWeights.max());
+    selfNormalisedWeights /= arma::accu(selfNormalisedWeights);
     // effective sample size:
     ess = 1.0 / arma::dot(selfNormalisedWeights, selfNormalisedWeights); 
     
@@ -680,7 +838,7 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
       
 //       std::cout << "resampling in the filter at time " << t << std::endl;
       // update estimate of the normalising constant:
-      logLikelihoodEstimate_ += std::log(arma::sum(arma::exp(logUnnormalisedWeights))); 
+      logLikelihoodEstimate_ += std::log(arma::accu(arma::exp(logUnnormalisedWeights))); 
       
      
       
@@ -705,21 +863,10 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
       // Obtaining the parent indices via adaptive systamatic resampling:           
       if (isConditional_) // "conditional" resampling
       {
-        if (resampleType_ == SMC_RESAMPLE_SYSTEMATIC)
-        {
-          resample::conditionalSystematicBase(u, parentIndices, 
-                                              singleParticleIndex, 
-                                              selfNormalisedWeights, 
-                                              nParticles_, singleParentIndex);
-        }
-        else if (resampleType_ == SMC_RESAMPLE_MULTINOMIAL)
-        {
-          resample::conditionalMultinomialBase(parentIndices, 
-                                              singleParticleIndex, 
-                                              selfNormalisedWeights, 
-                                              nParticles_, singleParentIndex);
-          
-        }
+        Resampler::resampleConditional(u, parentIndices, 
+                                       singleParticleIndex, 
+                                       selfNormalisedWeights, 
+                                       nParticles_, singleParentIndex);
         
         particleIndicesIn_(t) = singleParticleIndex;
       }
@@ -733,16 +880,9 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
         // resample::hilbertBase(u, parentIndices, particlesNew, selfNormalisedWeights, nParticles_, -3.0, 3.0);
         
         }
-        else // standard systematic resampling (without sorting)
+        else // standard resampling (without sorting)
         {
-          if (resampleType_ == SMC_RESAMPLE_SYSTEMATIC)
-          {
-            resample::systematicBase(u, parentIndices, selfNormalisedWeights, nParticles_);
-          }
-          else if (resampleType_ == SMC_RESAMPLE_MULTINOMIAL)
-          {
-            resample::multinomialBase(parentIndices, selfNormalisedWeights, nParticles_);
-          }
+          Resampler::resample(u, parentIndices, selfNormalisedWeights, nParticles_);
         }
       }
       logUnnormalisedWeights.fill(-std::log(nParticles_)); // resetting the weights
@@ -756,7 +896,10 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
       {
         particleIndicesIn_(t) = particleIndicesIn_(t-1);
       }
-      parentIndices = arma::linspace<arma::uvec>(0, nParticles_-1, nParticles_);
+      for (unsigned int n=0; n<nParticles_; n++)
+      {
+        parentIndices(n) = n;
+      }
     }
     // Determining the parent particles based on the parent indices: 
     for (unsigned int n=0; n<nParticles_; n++)
@@ -870,7 +1013,7 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
 //   }
   
   // Updating the estimate of the normalising constant:
-  logLikelihoodEstimate_ += std::log(arma::sum(arma::exp(logUnnormalisedWeights)));
+  logLikelihoodEstimate_ += std::log(arma::accu(arma::exp(logUnnormalisedWeights)));
   
   
 //   std::cout << "logLikelihoodEstimate:" << logLikelihoodEstimate_ << std::endl;
@@ -974,7 +1117,7 @@ double Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observa
   
   /// We need to loop this over however many SMC runs we need for the model
   runSmcBase(auxFull);
-  if (samplePath_)
+  if (samplePath_ && !isEarlyRejected_)
   {
     samplePath(latentPath);
   }
@@ -1001,6 +1144,33 @@ double Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observa
   samplePath(latentPath);
   return getLoglikelihoodEstimate();
 }
+/// Runs a conditional SMC algorithm and additionally selects 
+/// additionalLatentPaths.size() further paths from the final particle system.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class SmcParameters> 
+double Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, SmcParameters>::runCsmc
+(
+  const unsigned int nParticles, 
+  const arma::colvec& theta,
+  LatentPath& latentPath,
+  std::vector<LatentPath>& additionalLatentPaths,
+  AuxFull<Aux>& auxFull,
+  const double inverseTemperature
+)
+{
+  model_.setUnknownParameters(theta);
+  model_.setInverseTemperature(inverseTemperature);
+  nParticles_ = nParticles;
+  isConditional_ = true;
+  convertLatentPathToParticlePath(latentPath, particlePath_);
+  runSmcBase(auxFull);
+  
+  // Each path is selected independently from the particle system 
+  // (via backward sampling or by tracing back the ancestral lineage);
+  // only the first one is the new state of the CSMC kernel.
+  samplePath(latentPath);
+  sampleAdditionalPaths(additionalLatentPaths);
+  return getLoglikelihoodEstimate();
+}
 /// Runs a conditional SMC algorithm.
 template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class SmcParameters> 
 double Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, SmcParameters>::runCsmcWithoutPathSampling
@@ -1049,11 +1219,11 @@ double Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observa
   }
   
   runSmcBase(auxFull);
-  if (samplePath_)
+  if (samplePath_ && !isEarlyRejected_)
   {
     samplePath(latentPath);
   }
-  if (approximateGradient_)
+  if (approximateGradient_ && !isEarlyRejected_)
   {
     runFixedLagSmoothing(gradientEstimate);
   }
@@ -1083,11 +1253,11 @@ double Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observa
   }
   
   runSmcBase(auxFull);
-  if (samplePath_)
+  if (samplePath_ && !isEarlyRejected_)
   {
     samplePath(latentPath);
   }
-  if (approximateGradient_)
+  if (approximateGradient_ && !isEarlyRejected_)
   {
     runFixedLagSmoothing(gradientEstimate);
   }
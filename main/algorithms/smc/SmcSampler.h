@@ -78,6 +78,153 @@ public:
 
 
 
+/// Class for solving CESS(alpha) = CESS* (or ESS(alpha) = ESS*) for the
+/// next inverse temperature in adaptive tempering. The solver works with
+/// the increment delta = alpha - alphaOld and uses the analytic derivative
+/// of the (conditional) ESS with respect to delta in a safeguarded Newton
+/// iteration. The log-likelihoods are shifted by their maximum once per
+/// tempering step so that the exponentials cannot overflow.
+class TemperingSolver
+{
+public:
+  
+  /// Initialises the class.
+  TemperingSolver()
+  {
+    nCandidates_ = 8;
+    nIterations_ = 100;
+    tolX_ = 0.000000001;
+    tolF_ = 0.000000001;
+  }
+  
+  /// Specifies the self-normalised weights and log-likelihoods of the 
+  /// current particle system and whether the CESS or the ESS is targeted.
+  void setWeights(const arma::colvec& selfNormalisedWeights, const arma::colvec& logLikelihoods, const bool isConditional = true)
+  {
+    // Precomputed max-shift (over all particles with positive weight):
+    double logLikelihoodMax = - std::numeric_limits<double>::infinity();
+    for (unsigned int n=0; n<logLikelihoods.size(); n++)
+    {
+      if (selfNormalisedWeights(n) > 0 && logLikelihoods(n) > logLikelihoodMax)
+      {
+        logLikelihoodMax = logLikelihoods(n);
+      }
+    }
+    logLikelihoodsShifted_ = logLikelihoods - logLikelihoodMax;
+    weightsFirst_ = selfNormalisedWeights;
+    if (isConditional)
+    {
+      weightsSecond_ = selfNormalisedWeights;
+      scale_ = static_cast<double>(logLikelihoods.size());
+    }
+    else
+    {
+      weightsSecond_ = selfNormalisedWeights % selfNormalisedWeights;
+      scale_ = 1.0;
+    }
+  }
+  /// Specifies the number of candidate increments evaluated jointly to 
+  /// narrow down the bracketing interval.
+  void setNCandidates(const unsigned int nCandidates) {nCandidates_ = std::max(nCandidates, 1u);}
+  /// Specifies the maximum number of Newton iterations.
+  void setNIterations(const unsigned int nIterations) {nIterations_ = nIterations;}
+  
+  /// Returns the (C)ESS for the increment delta and stores its derivative
+  /// with respect to delta (both are computed in a single pass).
+  double evaluate(const double delta, double& derivative) const
+  {
+    double s1 = 0.0, s1Deriv = 0.0, s2 = 0.0, s2Deriv = 0.0;
+    double e, e2;
+    for (unsigned int n=0; n<weightsFirst_.size(); n++)
+    {
+      if (weightsFirst_(n) > 0 && std::isfinite(logLikelihoodsShifted_(n)))
+      {
+        e  = std::exp(delta * logLikelihoodsShifted_(n));
+        e2 = e * e;
+        s1      += weightsFirst_(n) * e;
+        s1Deriv += weightsFirst_(n) * logLikelihoodsShifted_(n) * e;
+        s2      += weightsSecond_(n) * e2;
+        s2Deriv += weightsSecond_(n) * logLikelihoodsShifted_(n) * e2;
+      }
+      else if (weightsFirst_(n) > 0 && delta <= 0) // particles with zero likelihood only count if delta = 0
+      {
+        s1 += weightsFirst_(n);
+        s2 += weightsSecond_(n);
+      }
+    }
+    s2Deriv *= 2.0;
+    derivative = scale_ * s1 * (2.0 * s1Deriv * s2 - s1 * s2Deriv) / (s2 * s2);
+    return scale_ * s1 * s1 / s2;
+  }
+  /// Returns the (C)ESS for several (positive) increments in one pass 
+  /// over the particles.
+  arma::rowvec evaluate(const arma::rowvec& deltas) const
+  {
+    arma::mat expTerms = arma::exp(logLikelihoodsShifted_ * deltas);
+    arma::rowvec s1 = weightsFirst_.t() * expTerms;
+    arma::rowvec s2 = weightsSecond_.t() * (expTerms % expTerms);
+    return scale_ * (s1 % s1) / s2;
+  }
+  /// Returns the increment delta in [0, deltaMax] at which the (C)ESS 
+  /// equals target. 
+  double solve(bool& isBracketing, const double target, const double deltaMax)
+  {
+    // Narrow down the bracketing interval using a geometric grid of
+    // candidate increments which are evaluated jointly:
+    arma::rowvec deltas(nCandidates_);
+    for (unsigned int k=0; k<nCandidates_; k++)
+    {
+      deltas(k) = deltaMax * std::pow(2.0, static_cast<double>(k) - static_cast<double>(nCandidates_ - 1));
+    }
+    arma::rowvec values = evaluate(deltas) - target;
+    
+    double lb = 0.0;
+    double ub = deltaMax;
+    for (unsigned int k=0; k<nCandidates_; k++)
+    {
+      if (values(k) > 0)
+      {
+        lb = deltas(k);
+      }
+      else
+      {
+        ub = deltas(k);
+        break;
+      }
+    }
+    
+    // Each evaluation yields both the value and the derivative, so we 
+    // cache the last evaluation:
+    double deltaLast = - 1.0, valueLast = 0.0, derivativeLast = 0.0;
+    auto f = [&] (double delta) 
+    {
+      if (delta != deltaLast)
+      {
+        valueLast = evaluate(delta, derivativeLast);
+        deltaLast = delta;
+      }
+      return valueLast - target;
+    };
+    auto f1 = [&] (double delta) 
+    {
+      f(delta);
+      return derivativeLast;
+    };
+    return rootFinding::saveGuardedNewton(isBracketing, f, f1, lb, ub, tolX_, tolF_, nIterations_);
+  }
+  
+private:
+  
+  arma::colvec logLikelihoodsShifted_; // log-likelihoods shifted by their maximum
+  arma::colvec weightsFirst_; // weights in the numerator of the (C)ESS
+  arma::colvec weightsSecond_; // weights in the denominator of the (C)ESS
+  double scale_; // number of particles (CESS) or one (ESS)
+  unsigned int nCandidates_; // number of candidate increments evaluated jointly
+  unsigned int nIterations_; // maximum number of Newton iterations
+  double tolX_, tolF_; // tolerances
+  
+};
+
 /// Class template for running an SMC sampler.
 template<class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class ParticleLower, class Aux, class SmcParameters, class McmcParameters> class SmcSampler
 {
@@ -101,6 +248,10 @@ public:
     storeHistory_ = true; // TODO: make this accessible from the outside 
     nMetropolisHastingsUpdates_ = 1;
     useAdaptiveCessTarget_ = false;
+    useAdaptiveNParticlesLower_ = false;
+    acceptanceRateThresholdLower_ = 0.15;
+    nParticlesLowerMax_ = 10000;
+    useEarlyRejection_ = false;
   }
   
   /// Returns the estimate of the evidence.
@@ -183,6 +334,8 @@ public:
   std::vector<double> getAcceptanceRatesFirst() const {return acceptanceRatesFirst_;}
   /// Returns mean-autocorrelations between the particles before and after applying the the MH updates.
   std::vector<double> getMaxParticleAutocorrelations() const {return maxParticleAutocorrelations_;}
+  /// Returns the number of lower-level particles used at each step of the SMC sampler.
+  std::vector<unsigned int> getNParticlesLower() const {return nParticlesLower_;}
   
   /// Specifies the number of particles.
   void setNParticles(const unsigned int nParticles) {nParticles_ = nParticles;}
@@ -202,6 +355,24 @@ public:
   bool getUseDoubleTempering() const {return useDoubleTempering_;}
   /// Specifies whether both likelihood terms should be tempered separately.
   void setUseDoubleTempering(const bool useDoubleTempering) {useDoubleTempering_ = useDoubleTempering;}
+  /// Specifies whether the number of lower-level particles should be doubled
+  /// whenever the acceptance rate of the MH updates falls below some threshold.
+  void setUseAdaptiveNParticlesLower(const bool useAdaptiveNParticlesLower) {useAdaptiveNParticlesLower_ = useAdaptiveNParticlesLower;}
+  /// Specifies whether the lower-level SMC algorithm should be aborted 
+  /// as soon as the MH update can no longer be accepted. This requires an 
+  /// upper bound, maxLogIncrementalWeight, on the log-incremental particle 
+  /// weights at each lower-level SMC step, i.e. on log[g(y|x) f(x|x') / q(x|x')]
+  /// (not merely on the log-observation density unless the proposal is the 
+  /// prior). If the bound is violated, the sampler is no longer valid.
+  void setUseEarlyRejection(const bool useEarlyRejection, const double maxLogIncrementalWeight)
+  {
+    useEarlyRejection_ = useEarlyRejection;
+    smc_.setMaxLogLikelihoodIncrement(maxLogIncrementalWeight);
+  }
+  /// Specifies the acceptance rate below which the number of lower-level particles is doubled.
+  void setAcceptanceRateThresholdLower(const double acceptanceRateThresholdLower) {acceptanceRateThresholdLower_ = acceptanceRateThresholdLower;}
+  /// Specifies the maximum number of lower-level particles.
+  void setNParticlesLowerMax(const unsigned int nParticlesLowerMax) {nParticlesLowerMax_ = nParticlesLowerMax;}
   /// Specifies the ESS resampling threshold.
   void setEssResamplingThreshold(const double essResamplingThreshold) {essResamplingThreshold_ = essResamplingThreshold;}
   /// Specifies the CESS target.
@@ -257,6 +428,12 @@ private:
       arma::accu(arma::exp(2.0*logUnnormalisedWeights + 2.0*(alphaNew-alphaOld)*logLikeNorm));
 
   }
+  /// Returns the next inverse temperature, i.e. the solution of
+  /// CESS(alpha) = nParticles_ * cessTarget in [alphaOld_, 2].
+  double computeNextInverseTemperature(bool& isBracketing, const double cessTarget)
+  {
+    return alphaOld_ + temperingSolver_.solve(isBracketing, nParticles_ * cessTarget, 2.0 - alphaOld_);
+  }
   /// Calculates the conditional effective sample size.
   double computeCess(const double alphaNew, const double alphaOld, const arma::colvec& selfNormalisedWeights, const arma::colvec& logLikelihood)
   {
@@ -289,6 +466,11 @@ private:
         selfNormalisedWeights(n) * (particles[n].theta_ - sampleMean_) * arma::trans(particles[n].theta_ - sampleMean_);
     }
     mcmc_.setSampleCovarianceMatrix(sampleCovarianceMatrix_ + 0.0001 * arma::eye(sampleCovarianceMatrix_.n_rows, sampleCovarianceMatrix_.n_cols));
+    if (mcmc_.getUseGradients())
+    {
+      // The gradient-based kernels are preconditioned by the population covariance matrix.
+      mcmc_.setPreconditioner(sampleCovarianceMatrix_ + 0.0001 * arma::eye(sampleCovarianceMatrix_.n_rows, sampleCovarianceMatrix_.n_cols));
+    }
   }
   /// Initialises a particle by sampling theta from the prior
   /// and potentially running a lower-level SMC algorithm.
@@ -357,7 +539,23 @@ private:
     
     if (mcmc_.getUseGradients())
     {
-      std::cout << "WARNING: use of gradient information has not yet been implemented!" << std::endl;
+      if (lower_ == SMC_SAMPLER_LOWER_PSEUDO_MARGINAL && !mcmc_.getUseDelayedAcceptance() && particleOld.gradient_.size() == model_.getDimTheta())
+      {
+        // The Hamiltonian kernels are only valid if the auxiliary variables
+        // of the lower-level SMC algorithm can be kept fixed along the 
+        // trajectory; otherwise, we fall back to Langevin kernels.
+        if (mcmc_.getGradientKernelType() == MCMC_GRADIENT_KERNEL_HAMILTONIAN && smc_.getUseGaussianParametrisation())
+        {
+          updateHamiltonian(particleNew, particleOld, alpha);
+          refreshAuxiliaryVariables(particleNew, alpha);
+        }
+        else
+        {
+          updateLangevin(particleNew, particleOld, alpha);
+        }
+        return;
+      }
+      std::cout << "WARNING: gradient-based kernels require a pseudo-marginal lower-level SMC algorithm which approximates the gradient and cannot be combined with delayed acceptance!" << std::endl;
     }
     
     if (mcmc_.getUseDelayedAcceptance())
@@ -387,6 +585,8 @@ private:
 //         std::cout << "################### ACCEPTANCE AT STAGE 1 ###################" << std::endl;
         nAcceptedMovesFirst_++;
         
+        double logU = std::log(arma::randu()); // drawn in advance for early rejection
+        
         if (lower_ == SMC_SAMPLER_LOWER_PSEUDO_MARGINAL)
         {
           
@@ -395,7 +595,7 @@ private:
 //           t1 = clock(); // start timer
      /////////////////////////////////////////////////////////////////////////////
 
-          runSmcLower(particleProp);
+          runSmcLower(particleProp, computeLogLikelihoodSecondMin(logU, - alpha * particleOld.logLikelihoodSecond_, alpha));
           
           /////////////////////////////////////////////////////////////////////////////
 //           t2 = clock(); // stop timer 
@@ -409,8 +609,8 @@ private:
         }
         else if (lower_ == SMC_SAMPLER_LOWER_PSEUDO_MARGINAL_NOISY)
         {
-          runSmcLower(particleProp);
           runSmcLower(particleOld);
+          runSmcLower(particleProp, computeLogLikelihoodSecondMin(logU, - alpha * particleOld.logLikelihoodSecond_, alpha));
         }
         else // i.e. lower_ == SMC_SAMPLER_LOWER_MARGINAL
         {
@@ -419,7 +619,7 @@ private:
         }
         logAlpha = alpha * (particleProp.logLikelihoodSecond_ - particleOld.logLikelihoodSecond_);
                   
-        if (std::isfinite(logAlpha) && log(arma::randu()) < logAlpha)
+        if (std::isfinite(logAlpha) && logU < logAlpha)
         {
 //           std::cout << "################### ACCEPTANCE AT STAGE 2 ###################" << std::endl;
           nAcceptedMoves_++;
@@ -446,10 +646,12 @@ private:
         
       if (std::isfinite(logAlpha))
       {
+        double logU = std::log(arma::randu()); // drawn in advance for early rejection
+        
         if (lower_ == SMC_SAMPLER_LOWER_PSEUDO_MARGINAL)
         {
           evaluateLogMarginalLikelihoodFirst(particleProp);
-          runSmcLower(particleProp);
+          runSmcLower(particleProp, computeLogLikelihoodSecondMin(logU, logAlpha + alpha * (particleProp.logLikelihoodFirst_ - particleOld.getlogLikelihood()), alpha));
         }
         else if (lower_ == SMC_SAMPLER_LOWER_PSEUDO_MARGINAL_CORRELATED)
         {
@@ -458,8 +660,8 @@ private:
         else if (lower_ == SMC_SAMPLER_LOWER_PSEUDO_MARGINAL_NOISY)
         {
           evaluateLogMarginalLikelihoodFirst(particleProp);
-          runSmcLower(particleProp);
           runSmcLower(particleOld);
+          runSmcLower(particleProp, computeLogLikelihoodSecondMin(logU, logAlpha + alpha * (particleProp.logLikelihoodFirst_ - particleOld.getlogLikelihood()), alpha));
         }
         else // i.e. lower_ == SMC_SAMPLER_LOWER_MARGINAL
         {
@@ -468,7 +670,7 @@ private:
         }
         logAlpha += alpha * (particleProp.getlogLikelihood() - particleOld.getlogLikelihood());
                   
-        if (std::isfinite(logAlpha) && log(arma::randu()) < logAlpha)
+        if (std::isfinite(logAlpha) && logU < logAlpha)
         {
 //           std::cout << "################### ACCEPTANCE ###################" << std::endl;
           nAcceptedMoves_++;
@@ -485,6 +687,127 @@ private:
       }
     }
   }
+  /// Computes the gradient of the log-tempered target density, i.e. of the 
+  /// log-prior density plus alpha times the log-likelihood, where the score 
+  /// is the estimate obtained from the lower-level SMC algorithm (via 
+  /// fixed-lag smoothing).
+  void computeTemperedGradient(const ParticleUpper<LatentPath, Aux>& particle, const double alpha, arma::colvec& gradient)
+  {
+    arma::colvec gradLogPrior(model_.getDimTheta(), arma::fill::zeros);
+    model_.setUnknownParameters(particle.theta_);
+    model_.addGradLogPriorDensity(gradLogPrior);
+    // NOTE: particle.gradient_ already includes the gradient of the log-prior density.
+    gradient = gradLogPrior + alpha * (particle.gradient_ - gradLogPrior);
+  }
+  /// Updates a particle using a (pseudo-marginal) preconditioned 
+  /// Metropolis-adjusted Langevin kernel. The gradient is a deterministic 
+  /// function of the parameters and of the random variables used by the
+  /// lower-level SMC algorithm so that the kernel leaves the extended 
+  /// target distribution invariant.
+  void updateLangevin(ParticleUpper<LatentPath, Aux>& particleNew, ParticleUpper<LatentPath, Aux>& particleOld, const double alpha)
+  {
+    ParticleUpper<LatentPath, Aux> particleProp;
+    particleProp.initialise(model_.getDimTheta());
+    arma::colvec gradientOld, gradientProp;
+    
+    computeTemperedGradient(particleOld, alpha, gradientOld);
+    mcmc_.proposeThetaLangevin(particleProp.theta_, particleOld.theta_, gradientOld);
+    double logAlpha = 
+      evaluateLogPriorDensity(particleProp.theta_) - 
+      evaluateLogPriorDensity(particleOld.theta_);
+      
+    if (std::isfinite(logAlpha))
+    {
+      evaluateLogMarginalLikelihoodFirst(particleProp);
+      runSmcLower(particleProp);
+      computeTemperedGradient(particleProp, alpha, gradientProp);
+      
+      logAlpha += alpha * (particleProp.getlogLikelihood() - particleOld.getlogLikelihood()) + 
+        mcmc_.evaluateLogProposalDensityLangevin(particleOld.theta_, particleProp.theta_, gradientProp) -
+        mcmc_.evaluateLogProposalDensityLangevin(particleProp.theta_, particleOld.theta_, gradientOld);
+    }
+    if (std::isfinite(logAlpha) && log(arma::randu()) < logAlpha)
+    {
+      nAcceptedMoves_++;
+      particleNew = particleProp;
+    }
+    else
+    {
+      particleNew = particleOld;
+    }
+  }
+  /// Updates a particle using a (pseudo-marginal) preconditioned 
+  /// Hamiltonian Monte Carlo kernel. Each leapfrog step requires one run 
+  /// of the lower-level SMC algorithm. This requires the Gaussian 
+  /// parametrisation of the lower-level SMC algorithm: its auxiliary 
+  /// variables are kept fixed along the trajectory so that the leapfrog 
+  /// integrator is reversible and volume preserving. The auxiliary 
+  /// variables must therefore be refreshed separately 
+  /// (see refreshAuxiliaryVariables()).
+  void updateHamiltonian(ParticleUpper<LatentPath, Aux>& particleNew, ParticleUpper<LatentPath, Aux>& particleOld, const double alpha)
+  {
+    ParticleUpper<LatentPath, Aux> particleProp = particleOld;
+    arma::colvec momentum, gradient;
+    
+    mcmc_.sampleMomentum(momentum);
+    double logAlpha = 
+      - evaluateLogPriorDensity(particleOld.theta_) - alpha * particleOld.getlogLikelihood() + 
+      mcmc_.evaluateKineticEnergy(momentum);
+    
+    smc_.setDetermineParticlesFromGaussians(true);
+    
+    computeTemperedGradient(particleOld, alpha, gradient);
+    mcmc_.updateMomentum(momentum, gradient, 0.5);
+    
+    for (unsigned int l=0; l<mcmc_.getNLeapfrogSteps(); l++)
+    {
+      mcmc_.updatePosition(particleProp.theta_, momentum);
+      if (!std::isfinite(evaluateLogPriorDensity(particleProp.theta_)))
+      {
+        break; // the trajectory has left the support of the prior
+      }
+      evaluateLogMarginalLikelihoodFirst(particleProp);
+      runSmcLower(particleProp);
+      computeTemperedGradient(particleProp, alpha, gradient);
+      mcmc_.updateMomentum(momentum, gradient, l+1 < mcmc_.getNLeapfrogSteps() ? 1.0 : 0.5);
+    }
+    
+    smc_.setDetermineParticlesFromGaussians(false);
+    
+    logAlpha += evaluateLogPriorDensity(particleProp.theta_) + alpha * particleProp.getlogLikelihood() - 
+      mcmc_.evaluateKineticEnergy(momentum);
+      
+    if (std::isfinite(logAlpha) && log(arma::randu()) < logAlpha)
+    {
+      nAcceptedMoves_++;
+      particleNew = particleProp;
+    }
+    else
+    {
+      particleNew = particleOld;
+    }
+  }
+  /// Updates the Gaussian auxiliary variables of the lower-level SMC 
+  /// algorithm (for fixed parameters) via a correlated pseudo-marginal 
+  /// kernel with Crank--Nicolson proposal. This leaves the extended target
+  /// distribution invariant and is alternated with the Hamiltonian kernels 
+  /// which keep these auxiliary variables fixed.
+  void refreshAuxiliaryVariables(ParticleUpper<LatentPath, Aux>& particle, const double alpha)
+  {
+    ParticleUpper<LatentPath, Aux> particleProp = particle;
+    double correlationParameter = alpha > 0 ? mcmc_.getCrankNicolsonScale(smc_.getNParticles(), alpha) : 0.0;
+    particleProp.aux_.addCorrelatedGaussianNoise(correlationParameter);
+    
+    smc_.setDetermineParticlesFromGaussians(true);
+    runSmcLower(particleProp);
+    smc_.setDetermineParticlesFromGaussians(false);
+    
+    double logAlpha = alpha * (particleProp.logLikelihoodSecond_ - particle.logLikelihoodSecond_);
+    if (std::isfinite(logAlpha) && log(arma::randu()) < logAlpha)
+    {
+      particle = particleProp;
+    }
+  }
   /// Updates a particle in the first stage of the dual-tempering
   /// SMC sampler using some suitable MCMC kernel.
   void updateFirst(unsigned int t, ParticleUpper<LatentPath, Aux>& particleNew, ParticleUpper<LatentPath, Aux>& particleOld, const double alpha)
@@ -496,7 +819,7 @@ private:
     
     if (mcmc_.getUseGradients())
     {
-      std::cout << "WARNING: use of gradient information has not yet been implemented!" << std::endl;
+      std::cout << "WARNING: gradient-based kernels have not yet been implemented for the dual-tempering SMC sampler!" << std::endl;
     }
     
     mcmc_.proposeTheta(t, particleProp.theta_, particleOld.theta_);
@@ -550,7 +873,7 @@ private:
     
     if (mcmc_.getUseGradients())
     {
-      std::cout << "WARNING: use of gradient information has not yet been implemented!" << std::endl;
+      std::cout << "WARNING: gradient-based kernels have not yet been implemented for the dual-tempering SMC sampler!" << std::endl;
     }
     
     if (mcmc_.getUseDelayedAcceptance())
@@ -677,6 +1000,50 @@ private:
   {
     particle.logLikelihoodSecond_ = smc_.runSmc(particle.theta_, particle.latentPath_, particle.aux_, particle.gradient_); // TODO: need to implement this function in the smc class
   }
+  /// Wrapper for the lower-level SMC filter which is aborted as soon as
+  /// the estimate of the second part of the log-likelihood can no longer 
+  /// exceed logLikelihoodSecondMin.
+  void runSmcLower(ParticleUpper<LatentPath, Aux>& particle, const double logLikelihoodSecondMin)
+  {
+    smc_.setEarlyRejectionThreshold(logLikelihoodSecondMin);
+    runSmcLower(particle);
+    smc_.setEarlyRejectionThreshold(- std::numeric_limits<double>::infinity());
+  }
+  /// Returns the smallest value of the second part of the log-likelihood of 
+  /// the proposed particle for which an MH update with acceptance ratio 
+  /// logAlphaRest + alpha * logLikelihoodSecond can still be accepted given 
+  /// the (log-)uniform random variable logU; returns minus infinity 
+  /// unless early rejection is used.
+  double computeLogLikelihoodSecondMin(const double logU, const double logAlphaRest, const double alpha)
+  {
+    if (useEarlyRejection_ && alpha > 0)
+    {
+      return (logU - logAlphaRest) / alpha;
+    }
+    else
+    {
+      return - std::numeric_limits<double>::infinity();
+    }
+  }
+  /// Doubles the number of lower-level particles and re-runs the lower-level
+  /// SMC algorithm for each particle. The weights are then corrected via the 
+  /// generalised importance-sampling exchange step from Chopin, Jacob & 
+  /// Papaspiliopoulos (2013), i.e. by the ratio of the new and old 
+  /// (tempered) marginal-likelihood estimates.
+  void exchangeLowerParticles(std::vector<ParticleUpper<LatentPath, Aux>>& particles, arma::colvec& logUnnormalisedWeights, arma::colvec& logLikelihoods, const double alpha)
+  {
+    smc_.setNParticles(std::min(2 * smc_.getNParticles(), nParticlesLowerMax_));
+    std::cout << "Increasing the number of lower-level particles to " << smc_.getNParticles() << std::endl;
+    
+    double logLikelihoodSecondOld;
+    for (unsigned int n=0; n<nParticles_; n++)
+    {
+      logLikelihoodSecondOld = particles[n].logLikelihoodSecond_;
+      runSmcLower(particles[n]);
+      logUnnormalisedWeights(n) += alpha * (particles[n].logLikelihoodSecond_ - logLikelihoodSecondOld);
+      logLikelihoods(n) = particles[n].getlogLikelihood();
+    }
+  }
   /// Wrapper for sampling the parameters from their prior
   void sampleFromPrior(ParticleUpper<LatentPath, Aux>& particle)
   {
@@ -714,6 +1081,7 @@ private:
   
   double cessTarget_; // value of conditional ESS targeted if adaptive tempering is used
   double cessTargetFirst_; // value of conditional ESS targeted if adaptive tempering is used (in the first stage of a double tempering approach)
+  TemperingSolver temperingSolver_; // solves CESS(alpha) = CESS* for the next inverse temperature
   bool storeHistory_; // store history of the particle system?
   bool useDoubleTempering_; // should we temper the two likelihood terms separately?
   
@@ -724,6 +1092,11 @@ private:
   std::vector<double> acceptanceRates_; // empirical acceptance rate at each step of the algorithm
   std::vector<double> acceptanceRatesFirst_; // empirical acceptance rate for the first stage of a delayed-acceptance MH update at each step of the algorithm
   std::vector<double> maxParticleAutocorrelations_; // mean-empirical autocorrelations between particles before and after applying the MH update
+  bool useAdaptiveNParticlesLower_; // should the number of lower-level particles be doubled if the acceptance rate is too low?
+  double acceptanceRateThresholdLower_; // acceptance rate below which the number of lower-level particles is doubled
+  unsigned int nParticlesLowerMax_; // maximum number of lower-level particles
+  std::vector<unsigned int> nParticlesLower_; // number of lower-level particles used at each step of the algorithm
+  bool useEarlyRejection_; // should the lower-level SMC algorithm be aborted as soon as the MH update can no longer be accepted?
   unsigned int nAcceptedMoves_; // number of accepted MH proposals in the current step of the SMC sampler
   unsigned int nAcceptedMovesFirst_; // number of accepted MH proposals in the first stage of a delayed-acceptance MH update at each step of the algorithm
   
@@ -802,6 +1175,14 @@ void SmcSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Ob
   
   unsigned int t = 0; // step counter
   
+  nParticlesLower_.clear();
+  nParticlesLower_.push_back(smc_.getNParticles());
+  
+  if (mcmc_.getUseGradients() && mcmc_.getGradientKernelType() == MCMC_GRADIENT_KERNEL_HAMILTONIAN && !smc_.getUseGaussianParametrisation())
+  {
+    std::cout << "WARNING: Hamiltonian Monte Carlo kernels require the Gaussian parametrisation of the lower-level SMC algorithm; using Langevin kernels instead!" << std::endl;
+  }
+  
   // TODO: initialise the "...Full_" quantities and figure out how to best grow these matrices if adaptive tempering is used 
   
   if (useAdaptiveTempering_)
@@ -935,13 +1316,13 @@ void SmcSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Ob
           adaptedCessTarget = cessTargetMax_;
         }
         std::cout << "adapted CESS Target: " << adaptedCessTarget << std::endl;
-        auto f = [&] (double alpha) {return computeCess(alpha, alphaOld_, selfNormalisedWeights, logLikelihoods) - nParticles_* adaptedCessTarget;};
-        alphaNew_ = rootFinding::bisection(isBracketing, f, alphaOld_, 2.0, 0.000000001, 0.000000001, 1000);
-        std::cout << "next inverse temperature found by bisection: " << alphaNew_ << std::endl;
+        temperingSolver_.setWeights(selfNormalisedWeights, logLikelihoods);
+        bool isBracketingTest;
+        double alphaNewTest = computeNextInverseTemperature(isBracketingTest, cessTarget_);
+        alphaNew_ = computeNextInverseTemperature(isBracketing, adaptedCessTarget);
+        std::cout << "next inverse temperature found by Newton's method: " << alphaNew_ << std::endl;
         
         ////////////
-        auto gg = [&] (double alpha) {return computeCess(alpha, alphaOld_, selfNormalisedWeights, logLikelihoods) - nParticles_* cessTarget_;};
-        double alphaNewTest = rootFinding::bisection(isBracketing, gg, alphaOld_, 2.0, 0.000000001, 0.000000001, 1000);
         std::cout << "next inverse temperature if we hadn't adapted the CESS target: " << alphaNewTest << std::endl;
         ///////////
       }
@@ -953,10 +1334,9 @@ void SmcSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Ob
       }
       else
       {
-        // Computes CESS(alpha) for given weights:
-        auto f = [&] (double alpha) {return computeCess(alpha, alphaOld_, selfNormalisedWeights, logLikelihoods) - nParticles_* cessTarget_;};
-        alphaNew_ = rootFinding::bisection(isBracketing, f, alphaOld_, 2.0, 0.000000001, 0.000000001, 1000);
-        std::cout << "next inverse temperature found by bisection: " << alphaNew_ << std::endl;
+        temperingSolver_.setWeights(selfNormalisedWeights, logLikelihoods);
+        alphaNew_ = computeNextInverseTemperature(isBracketing, cessTarget_);
+        std::cout << "next inverse temperature found by Newton's method: " << alphaNew_ << std::endl;
       }
 
 
@@ -994,7 +1374,7 @@ void SmcSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Ob
     // Compute proposal scale
     // --------------------------------------------------------------------- //
 
-    if (mcmc_.getUseAdaptiveProposal())
+    if (mcmc_.getUseAdaptiveProposal() || mcmc_.getUseGradients())
     {
       // Computes the first two moments of the weighted sample.
       computeSampleMoments(particlesNew, selfNormalisedWeights);
@@ -1187,6 +1567,18 @@ void SmcSampler<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Ob
     std::cout << "Overall acceptance rate: " << acceptanceRates_[acceptanceRates_.size()-1] << std::endl;
     nAcceptedMoves_ = 0;
     
+    // --------------------------------------------------------------------- //
+    // Adapt the number of lower-level particles (SMC^2)
+    // --------------------------------------------------------------------- //
+    
+    if (useAdaptiveNParticlesLower_ && lower_ != SMC_SAMPLER_LOWER_MARGINAL && alphaNew_ < 1.0 &&
+        acceptanceRates_[acceptanceRates_.size()-1] < acceptanceRateThresholdLower_ &&
+        smc_.getNParticles() < nParticlesLowerMax_)
+    {
+      exchangeLowerParticles(particlesNew, logUnnormalisedWeights, logLikelihoods, alphaNew_);
+      selfNormalisedWeights = normaliseWeights(logUnnormalisedWeights);
+    }
+    nParticlesLower_.push_back(smc_.getNParticles());
 
     // --------------------------------------------------------------------- //
     // Store output
@@ -1396,13 +1788,9 @@ if (useAdaptiveTempering_)
     { // Adaptive tempering, 
       // i.e. numerically solve CESS(alpha) = CESS* for alpha:
       
-      // Computes CESS(alpha) for given weights:
-      
-      auto f = [&] (double alpha) {return computeCess(alpha, alphaOld_, selfNormalisedWeights, logLikelihoods) - nParticles_* cessTarget;};
-
-      alphaNew_ = rootFinding::bisection(isBracketing, f, alphaOld_, 2.0, 0.000000001, 0.000000001, 1000);
-
-      std::cout << "next inverse temperature found by bisection: " << alphaNew_ << std::endl;
+      temperingSolver_.setWeights(selfNormalisedWeights, logLikelihoods);
+      alphaNew_ = computeNextInverseTemperature(isBracketing, cessTarget);
+      std::cout << "next inverse temperature found by Newton's method: " << alphaNew_ << std::endl;
       
       if (!isBracketing) { std::cout << "Warning: interval is not bracketing!" << std::endl; }
       
@@ -1443,7 +1831,7 @@ if (useAdaptiveTempering_)
 //       computeSampleMoments(particlesNew, selfNormalisedWeights);
 //     }
 
-    if (mcmc_.getUseAdaptiveProposal())
+    if (mcmc_.getUseAdaptiveProposal() || mcmc_.getUseGradients())
     {
       // Computes the first two moments of the weighted sample.
       computeSampleMoments(particlesNew, selfNormalisedWeights);
@@ -67,23 +67,23 @@ namespace resample
     unsigned int N               // total number of offspring
   )        
   {
-    arma::colvec T = (arma::linspace(0, N-1, N) + u) / N;
-    arma::colvec Q = arma::cumsum(w);
-
+    // The strata and the cumulative weights are computed on the fly
+    // to avoid allocating temporary vectors at each resampling step.
+    // Note that the number of offspring, N, may differ from the number
+    // of weights, so the index is clamped at the last weight (which only
+    // guards against round-off in the cumulative sum).
+    const unsigned int iMax = w.n_elem - 1;
+    double Q = w(0); // cumulative weight
     unsigned int i = 0;
-    unsigned int j = 0;
       
-    while (j < N) 
+    for (unsigned int j=0; j<N; j++)
     {
-      if (T(j) <= Q(i)) 
-      {
-        parentIndices(j) = i;
-        ++j;
-      } 
-      else 
+      while ((j + u) / N > Q && i < iMax) 
       {
         ++i;
+        Q += w(i);
       }
+      parentIndices(j) = i;
     }
   }
   /// \brief Performs systematic resampling.
@@ -235,5 +235,48 @@ namespace resample
   { 
     conditionalSystematicBase(arma::randu(), parentIndices, b, w, N, a);
   }
+  
+  ////////////////////////////////////////////////////////////////////////////////
+  // Resampling policies
+  ////////////////////////////////////////////////////////////////////////////////
+  
+  /// \brief Policy for selecting systematic resampling at compile time.
+  struct SystematicPolicy
+  {
+    /// Performs (unconditional) resampling.
+    static void resample(const double u, arma::uvec& parentIndices, const arma::colvec& w, const unsigned int N)
+    {
+      systematicBase(u, parentIndices, w, N);
+    }
+    /// Performs conditional resampling.
+    static void resampleConditional(const double u, arma::uvec& parentIndices, unsigned int& b, const arma::colvec& w, const unsigned int N, const unsigned int a)
+    {
+      conditionalSystematicBase(u, parentIndices, b, w, N, a);
+    }
+    /// Returns the particle index of the reference path at the first step.
+    static unsigned int sampleInitialReferenceIndex(const unsigned int N)
+    {
+      return arma::as_scalar(arma::randi(1, arma::distr_param(0, N-1)));
+    }
+  };
+  /// \brief Policy for selecting multinomial resampling at compile time.
+  struct MultinomialPolicy
+  {
+    /// Performs (unconditional) resampling; the uniform random variable is not used.
+    static void resample(const double u, arma::uvec& parentIndices, const arma::colvec& w, const unsigned int N)
+    {
+      multinomialBase(parentIndices, w, N);
+    }
+    /// Performs conditional resampling; the uniform random variable is not used.
+    static void resampleConditional(const double u, arma::uvec& parentIndices, unsigned int& b, const arma::colvec& w, const unsigned int N, const unsigned int a)
+    {
+      conditionalMultinomialBase(parentIndices, b, w, N, a);
+    }
+    /// Returns the particle index of the reference path at the first step.
+    static unsigned int sampleInitialReferenceIndex(const unsigned int N)
+    {
+      return 0;
+    }
+  };
 }
 #endif
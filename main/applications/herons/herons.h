@@ -540,6 +540,8 @@ public:
   arma::colvec getLambda() const {return lambda_;}
   /// Returns the $i$th row of the multinomial ring-recovery probabilities
   arma::rowvec getQ(const unsigned int i) const {return Q_.row(i);}
+  /// Returns the matrix of multinomial probabilities for the ring-recovery data.
+  const arma::mat& getQ() const {return Q_;}
   /// Returns the mean of the approximate Gaussian prior on the initial state.
   arma::colvec getM0() const {return m0_;}
   /// Returns the covariance matrix of the approximate Gaussian prior on the initial state.
@@ -1205,8 +1207,21 @@ public:
   /// for which ring-recovery data is available
   unsigned int getNRinged(const unsigned int i) const { return nRinged_(i); }
   
+  /// Returns the log-likelihood of the ring-recovery data given the 
+  /// matrix of multinomial probabilities. The data-dependent quantities 
+  /// are computed only at the first call.
+  double evaluateLogLikelihoodRingRecovery(const arma::mat& Q)
+  {
+    if (!ringRecoveryLikelihood_.isInitialised())
+    {
+      ringRecoveryLikelihood_.setData(ringRecovery_, nRinged_);
+    }
+    return ringRecoveryLikelihood_.evaluate(Q);
+  }
+  
   arma::uvec nRinged_; // number of individuals ringed in the years in which ring-recovery data is available
   arma::umat ringRecovery_; // ring-recovery data
+  MultinomialLikelihood ringRecoveryLikelihood_; // precomputed data-dependent quantities of the multinomial likelihood for the ring-recovery data
   arma::uvec count_; // length-nObservationsCount_ vector of count data
 //   unsigned int t1Count_, t2Count_, t1Ring_, t2Ring_; // first/last years for which count/ring-recovery data is available
 
@@ -1712,6 +1727,7 @@ void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observa
 
   observations_.ringRecovery_.zeros(modelParameters_.getNObservationsRing(), modelParameters_.getNObservationsRing()+1);
   observations_.nRinged_.set_size(observations_.ringRecovery_.n_rows);
+  observations_.ringRecoveryLikelihood_.reset();
   
   unsigned int k;
   
@@ -2038,10 +2054,7 @@ double Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Obser
 {
   double logLike = 0.0;
   // Likelihood based on ring-recovery data
-  for (unsigned int i=0; i<modelParameters_.getNObservationsRing(); i++)
-  {
-    logLike += logMultinomialDensity(observations_.getRingRecovery(i), observations_.getNRinged(i), modelParameters_.getQ(i));
-  }
+  logLike += observations_.evaluateLogLikelihoodRingRecovery(modelParameters_.getQ());
   return logLike;
 }
 
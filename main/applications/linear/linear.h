@@ -313,6 +313,49 @@ void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observa
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// Batch versions of the model functions
+///////////////////////////////////////////////////////////////////////////////
+// These explicit specialisations replace the default loops over particles
+// from Model.h: all particles are stacked into one matrix so that the 
+// linear maps are applied via a single matrix product and the Gaussian 
+// densities are evaluated via a single triangular solve.
+
+/// Samples a whole population of latent variables at Time t>0.
+template <> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::sampleFromTransitionEquation(const unsigned int t, std::vector<LatentVariable>& latentVariablesNew, const std::vector<LatentVariable>& latentVariablesOld)
+{
+  arma::mat xOld;
+  convertStdVecToArmaMat(latentVariablesOld, xOld);
+  arma::mat xNew = modelParameters_.getA() * xOld + std::sqrt(getInverseTemperatureLat()) * modelParameters_.getB() * arma::randn<arma::mat>(modelParameters_.getDimLatentVariable(), xOld.n_cols);
+  convertArmaMatToStdVec(xNew, latentVariablesNew);
+}
+/// Evaluates the log-transition density of a whole population of latent variables.
+template <> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::evaluateLogTransitionDensity(const unsigned int t, const std::vector<LatentVariable>& latentVariablesNew, const std::vector<LatentVariable>& latentVariablesOld, arma::colvec& logDensities)
+{
+  arma::mat xNew, xOld;
+  convertStdVecToArmaMat(latentVariablesNew, xNew);
+  convertStdVecToArmaMat(latentVariablesOld, xOld);
+  logDensities = gaussian::evaluateDensityMultivariate(xNew, modelParameters_.getA() * xOld, std::sqrt(getInverseTemperatureLat()) * modelParameters_.getB(), true, true);
+}
+/// Evaluates the log-transition density of a single latent variable given a whole population of latent variables.
+template <> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::evaluateLogTransitionDensity(const unsigned int t, const LatentVariable& latentVariableNew, const std::vector<LatentVariable>& latentVariablesOld, arma::colvec& logDensities)
+{
+  arma::mat xOld;
+  convertStdVecToArmaMat(latentVariablesOld, xOld);
+  logDensities = gaussian::evaluateDensityMultivariate(latentVariableNew, modelParameters_.getA() * xOld, std::sqrt(getInverseTemperatureLat()) * modelParameters_.getB(), true, true);
+}
+/// Evaluates the log-observation density for a whole population of latent variables.
+template <> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::evaluateLogObservationDensity(const unsigned int t, const std::vector<LatentVariable>& latentVariables, arma::colvec& logDensities)
+{
+  arma::mat x;
+  convertStdVecToArmaMat(latentVariables, x);
+  logDensities = gaussian::evaluateDensityMultivariate(getObservations().col(t), modelParameters_.getC() * x, std::sqrt(getInverseTemperatureObs()) * modelParameters_.getD(), true, true);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Member functions of Smc class
 ///////////////////////////////////////////////////////////////////////////////
@@ -12,6 +12,7 @@
 // #include <gperftools/profiler.h>
 #include <iostream>
 #include <vector>
+#include <limits>
 #include "main/rng/Rng.h"
 #include "main/rng/gaussian.h"
 #include "main/helperFunctions/helperFunctions.h"
@@ -139,7 +140,8 @@ enum FilterType
 enum BackwardKernelType 
 {  
   SMC_BACKWARD_KERNEL_STANDARD = 0,
-  SMC_BACKWARD_KERNEL_BLOCK
+  SMC_BACKWARD_KERNEL_BLOCK,
+  SMC_BACKWARD_KERNEL_PARIS // PaRIS with M draws from the (blocked) backward kernel per particle
 };
 /// Type of parametrisation employed by parameter-estimation algorithms.
 enum ParametrisationType 
@@ -180,6 +182,7 @@ public:
     prop = prop_;
     para = para_;
     isSimple = isSimple_;
+    cores = cores_;
     theta.set_size(K+3);
     set_theta();
     setAuxiliaryParameters();
@@ -375,7 +378,7 @@ public:
   {
     back = back_;
     
-    if (back == SMC_BACKWARD_KERNEL_STANDARD && filt != SMC_FILTER_BLOCK)
+    if ((back == SMC_BACKWARD_KERNEL_STANDARD || back == SMC_BACKWARD_KERNEL_PARIS) && filt != SMC_FILTER_BLOCK)
     {
       arma::mat blockAux(2,1);
       blockAux(0,0) = 0;
@@ -739,6 +742,16 @@ public:
           
           // Step 1 
           double logZ = 0;
+          arma::colvec logZBlocks(nBlocks); // log-normalising constants of the individual blocks
+          
+          // Independent random-number streams for the resampling steps within 
+          // the individual blocks (seeded from the global stream):
+          std::vector<std::mt19937> blockEngines(nBlocks);
+          for (unsigned int j=0; j<nBlocks; j++)
+          {
+            blockEngines[j].seed(static_cast<unsigned int>(arma::as_scalar(arma::randi(1, arma::distr_param(0, std::numeric_limits<int>::max())))));
+          }
+          
           //std::cout << "BPF, Step " << 0 << std::endl;  
           initialiseSmc(particlesNew, logWeights, particlePath_); // logWeights is not actually used, here
           logLikeEst = 0;
@@ -752,24 +765,16 @@ public:
           for (unsigned int t=1; t<T; t++)
           {  
             //std::cout << "BPF, Step " << t << std::endl;  
+            #pragma omp parallel for num_threads(std::max(cores, 1u)) schedule(dynamic) if(nBlocks > 1)
             for (unsigned int j=0; j<nBlocks; j++) 
             {
-                         //   std::cout << "compute block parameters" << std::endl;
-              computeBlockParameters(j);
-                          //  std::cout << "compute local weights" << std::endl;
-              computeLocalWeights(logWeights, t-1, lInn, uInn);
-              
-              //std::cout << "calculating normalising constant estimate" << std::endl;
-              W = normaliseWeights(logWeights, logZ); // self-normalised weights for the jth block
-              logLikeEst += logZ; // approximate normalising constant
-              
-              parentIndices = sampleInt(N, W);
-              for (unsigned int n=0; n<N; n++) // TODO: maybe this loop can be avoided
-              {
-                particlesOld(arma::span(lInn,uInn), arma::span(n,n)) = particlesNew(arma::span(lInn,uInn), arma::span(parentIndices(n),parentIndices(n))); // Determining the parent particles for the current block  
-              }
+              resampleBlock(j, t, particlesNew, particlesOld, logZBlocks(j), blockEngines[j]);
             }
-            iterateSmc(t, particlesNew, particlesOld, logWeights, particlePath_); // logWeights is not actually used, here
+            logLikeEst += arma::accu(logZBlocks); // approximate normalising constant (summed in a fixed order)
+            
+            // Resetting the weights (all blocks are resampled at every step):
+            logWeights.fill(-log(N));
+            iterateSmc(t, particlesNew, particlesOld, logWeights, particlePath_);
 
             // Potentially storing the entire particle system
             if (storeHistory)
@@ -778,10 +783,13 @@ public:
               logWeightsFull.col(t) = logWeights;
             }
           }
+          // Final-step contribution of each block; each of the T local 
+          // normalising constants of a block is an unnormalised sum over N particles:
           for (unsigned int j=0; j<nBlocks; j++) 
           {
+            computeLocalWeights(logWeights, T-1, blockInn(0,j), blockInn(1,j));
             W = normaliseWeights(logWeights, logZ); // self-normalised weights for the jth block
-            logLikeEst += logZ - (T-1)*log(N); // approximate normalising constant
+            logLikeEst += logZ - T*log(N); // approximate normalising constant
           }
           
         }
@@ -851,7 +859,11 @@ public:
       gradCompEst.zeros(K+3,V);
     }
     
-    if (M < N && back == SMC_BACKWARD_KERNEL_STANDARD) // backward sampling use standard backward kernels
+    if (back == SMC_BACKWARD_KERNEL_PARIS) // PaRIS using M backward draws per particle
+    {
+      runParisSmoother();
+    }
+    else if (M < N && back == SMC_BACKWARD_KERNEL_STANDARD) // backward sampling use standard backward kernels
     {
 //       std::cout << "running standard BS" << std::endl;
       
@@ -1103,151 +1115,12 @@ public:
     }
     else if (M >= N && back == SMC_BACKWARD_KERNEL_BLOCK) // "forward" smoothing using blocked backward kernels
     {
-      
-//       std::cout << "running blocked FS" << std::endl;
-      
-      // Temporary quantities:
-      std::vector<arma::cube> suffHCompEstAuxOld(N);
-      std::vector<arma::mat> suffQCompEstAuxOld(N);
-      std::vector<arma::colvec> suffRCompEstAuxOld(N);
-      std::vector<arma::colvec> suffR1CompEstAuxOld(N);
-      std::vector<arma::colvec> suffSCompEstAuxOld(N);
-      
-      std::vector<arma::cube> suffHCompEstAuxNew(N);
-      std::vector<arma::mat> suffQCompEstAuxNew(N);
-      std::vector<arma::colvec> suffRCompEstAuxNew(N);
-      std::vector<arma::colvec> suffR1CompEstAuxNew(N);
-      std::vector<arma::colvec> suffSCompEstAuxNew(N);
-
-      arma::mat z(2*K+V, N, arma::fill::zeros); // this pads the particles with zeros to avoid issues on the boundary of the state space
-      double zk, zl;
-      
-      for (unsigned int j=0; j<nBlocks; j++)
-      {
-//         std::cout << "M>=N, blocked backward kernel, time: " << 0 << "; block: " << j << std::endl;
-        computeBlockParameters(j);
-        
-        // Time 0
-        for (unsigned int n=0; n<N; n++)
-        {
-          suffRCompEstAuxNew[n].zeros(blockSize);
-          suffSCompEstAuxNew[n].zeros(blockSize);
-          suffHCompEstAuxNew[n].zeros(K+1,K+1,blockSize);
-          suffQCompEstAuxNew[n].zeros(K+1,blockSize);
-          suffR1CompEstAuxNew[n].zeros(blockSize);
-          
-          suffRCompEstAuxOld[n].zeros(blockSize);
-          suffSCompEstAuxOld[n].zeros(blockSize);
-          suffHCompEstAuxOld[n].zeros(K+1,K+1,blockSize);
-          suffQCompEstAuxOld[n].zeros(K+1,blockSize);
-          suffR1CompEstAuxOld[n].zeros(blockSize);
-        
-          for (unsigned int v=0; v<blockSize; v++)
-          {
-            suffRCompEstAuxNew[n](v) += particlesFull(lInn+v,n,0) * particlesFull(lInn+v,n,0);
-            suffSCompEstAuxNew[n](v) += particlesFull(lInn+v,n,0) * y(lInn+v,0);
-          }
-        }
-        suffR1CompEstAuxNew = suffRCompEstAuxNew;
-        
-      
-        for (unsigned int t=1; t<T; t++)
-        {
-          meanAux = A(arma::span(lOut, uOut), arma::span(lOutNei, uOutNei))*particlesFull.slice(t-1).rows(arma::span(lOutNei, uOutNei));
-//           z.zeros();
-          z(arma::span(K,K+V-1), arma::span::all) = particlesFull.slice(t-1);
- 
-          // Temporary quantities:
-          suffHCompEstAuxOld.swap(suffHCompEstAuxNew);
-          suffQCompEstAuxOld.swap(suffQCompEstAuxNew);
-          suffRCompEstAuxOld.swap(suffRCompEstAuxNew);
-          suffR1CompEstAuxOld.swap(suffR1CompEstAuxNew);
-          suffSCompEstAuxOld.swap(suffSCompEstAuxNew);
-//           suffHCompEstAuxOld  = suffHCompEstAuxNew;
-//           suffQCompEstAuxOld  = suffQCompEstAuxNew;
-//           suffRCompEstAuxOld  = suffRCompEstAuxNew;
-//           suffR1CompEstAuxOld = suffR1CompEstAuxNew;
-//           suffSCompEstAuxOld  = suffSCompEstAuxNew;
-                    
-          for (unsigned int n=0; n<N; n++)
-          {  
-            
-            suffRCompEstAuxNew[n].zeros(blockSize);
-            suffSCompEstAuxNew[n].zeros(blockSize);
-            suffHCompEstAuxNew[n].zeros(K+1,K+1,blockSize);
-            suffQCompEstAuxNew[n].zeros(K+1,blockSize);
-            suffR1CompEstAuxNew[n].zeros(blockSize);
-            
-            // Backward kernel evaluated at all $N$ time-$t-1$ particles given the $n$th particle at time $t$
-            computeLocalWeights(logWeights, t-1, lOutNei, uOutNei); // calculates the local weights
-            logWeights = logWeights + 
-              gaussian::evaluateDensityMultivariate(
-                particlesFull.slice(t)(arma::span(lOut, uOut), arma::span(n,n)), 
-                meanAux, BBT(arma::span(lOut, uOut), arma::span(lOut, uOut)), false, true, cores
-              );
-              
-            backwardKernels = normaliseWeights(logWeights); // self-normalised backward kernels
-
-            for (unsigned int m=0; m<N; m++)
-            {
-              for (unsigned int v=0; v<blockSize; v++)
-              {
-                for (unsigned int k=0; k<K+1; k++)
-                {
-                  if (k == 0)
-                  {
-                    zk = z(K+lInn+v,m);
-                  }
-                  else
-                  {
-                    zk = z(K+lInn+v-k,m) + z(K+lInn+v+k,m);
-                  }
-
-                  suffQCompEstAuxNew[n](k,v) += backwardKernels(m) * (suffQCompEstAuxOld[m](k,v) + particlesFull(lInn+v,n,t) * zk);
-
-                  for (unsigned int l=0; l<K+1; l++)
-                  {
-                    if (l == 0)
-                    {
-                      zl = z(K+lInn+v,m);
-                    }
-                    else
-                    {
-                      zl = z(K+lInn+v-l,m) + z(K+lInn+v+l,m);
-                    }
-
-                    suffHCompEstAuxNew[n].slice(v)(k,l) += backwardKernels(m) * (suffHCompEstAuxOld[m].slice(v)(k,l) + zk * zl);
-                  }
-                }
-
-                suffR1CompEstAuxNew[n](v) += backwardKernels(m) * suffR1CompEstAuxOld[m](v);
-                suffRCompEstAuxNew[n](v)  += backwardKernels(m) * (suffRCompEstAuxOld[m](v) + particlesFull(lInn+v,n,t) * particlesFull(lInn+v,n,t));
-                suffSCompEstAuxNew[n](v)  += backwardKernels(m) * (suffSCompEstAuxOld[m](v) + particlesFull(lInn+v,n,t) * y(lInn+v,t));
-              }
-            }
-          }
-        }
-        
-        computeLocalWeights(logWeights, T-1, lOut, uOut); // calculates the local weights
-        arma::colvec W = normaliseWeights(logWeights);
-        
-        for (unsigned int n=0; n<N; n++) 
-        {
-          for (unsigned int v=0; v<blockSize; v++) 
-          {
-            suffRCompEst(lInn+v)       = suffRCompEst(lInn+v)       + W(n) * suffRCompEstAuxNew[n](v);
-            suffR1CompEst(lInn+v)      = suffR1CompEst(lInn+v)      + W(n) * suffR1CompEstAuxNew[n](v);
-            suffSCompEst(lInn+v)       = suffSCompEst(lInn+v)       + W(n) * suffSCompEstAuxNew[n](v);
-            suffHCompEst.slice(lInn+v) = suffHCompEst.slice(lInn+v) + W(n) * suffHCompEstAuxNew[n].slice(v);
-            suffQCompEst.col(lInn+v)   = suffQCompEst.col(lInn+v)   + W(n) * suffQCompEstAuxNew[n].col(v);
-          }
-        }
-      }   
+      runBlockedForwardSmoother();
     }
   
     if (storeSuff)
     {
-      if (M < N) 
+      if (M < N && back != SMC_BACKWARD_KERNEL_PARIS) 
       {
         suffHCompEst  = suffHCompEst  / M;
         suffQCompEst  = suffQCompEst  / M;
@@ -1806,7 +1679,20 @@ public:
         std::cout << "Compute gradient estimate for the " << j << "th block" << std::endl;
         ///////////////////////////////////////////////////////////////////////
         
-        if (updateAfterEachBlock)
+        if (updateAfterEachBlock && back == SMC_BACKWARD_KERNEL_PARIS)
+        {
+          updateAdditiveFunctionalsParis(alphaNew.slice(j), alphaOld.slice(j), t, particlesNew, particlesOld, 
+            blockNeighbourhoodWeightsOld.col(j), lInn, uInn, lInnNei, uInnNei, lInnInt, uInnInt);
+          gradBlockNew.col(j) = alphaNew.slice(j) * blockWeights.col(j);
+          
+          gradL2norm = sqrt(arma::as_scalar(arma::sum(arma::pow(gradBlockNew.col(j) - gradBlockOld.col(j), 2.0))));
+          theta = theta + stepSizes(p) * (gradBlockNew.col(j) - gradBlockOld.col(j)) / std::max(gradL2norm, 1.0);
+          std::cout << arma::trans(theta) << std::endl;
+          thetaFull.col(p) = theta;
+          setParameters();
+          p = p + 1;
+        }
+        else if (updateAfterEachBlock)
         {
           for (unsigned int n=0; n<N; n++)
           {
@@ -1846,6 +1732,14 @@ public:
         {
           computeBlockParameters(j);
           computeInteriorBlockParameters(padding);
+          
+          if (back == SMC_BACKWARD_KERNEL_PARIS)
+          {
+            updateAdditiveFunctionalsParis(alphaNew.slice(j), alphaOld.slice(j), t, particlesNew, particlesOld, 
+              blockNeighbourhoodWeightsOld.col(j), lOut, uOut, lOutNei, uOutNei, lInn, uInn);
+            gradBlockNew.col(j) = alphaNew.slice(j) * blockWeights.col(j);
+            continue;
+          }
                    
           for (unsigned int n=0; n<N; n++)
           {
@@ -2122,7 +2016,16 @@ public:
       
       for (unsigned int j=0; j<nBlocks; j++)
       {
-        computeBlockParameters(j);       
+        computeBlockParameters(j);
+        
+        if (back == SMC_BACKWARD_KERNEL_PARIS)
+        {
+          updateAdditiveFunctionalsParis(alphaNew.slice(j), alphaOld.slice(j), t, particlesNew, particlesOld, 
+            enlargedBlockNeighbourhoodWeightsOld.col(j), lOut, uOut, lOutNei, uOutNei, lInn, uInn);
+          gradBlockNew.col(j) = alphaNew.slice(j) * enlargedBlockWeights.col(j);
+          continue;
+        }
+        
         for (unsigned int n=0; n<N; n++)
         {
           for (unsigned int m=0; m<N; m++)
@@ -2363,14 +2266,14 @@ public:
         thetaProp(arma::span(K+1,K+2)) = thetaOld(arma::span(K+1,K+2)) + proposalScale * rwmhSd(arma::span(K+1,K+2)) % arma::randn<arma::colvec>(2);          
         break;
       case SMC_PARAMETRISATION_NATURAL:
-        thetaProp(K+1) = gaussian::rtnorm(0.0, arma::datum::inf, thetaOld(K+1), proposalScale * rwmhSd(K+1));
-        thetaProp(K+2) = gaussian::rtnorm(0.0, arma::datum::inf, thetaOld(K+2), proposalScale * rwmhSd(K+2));
+        thetaProp(K+1) = gaussian::rtnorm(0.0, arma::datum::inf, thetaOld(K+1), proposalScale * rwmhSd(K+1), true);
+        thetaProp(K+2) = gaussian::rtnorm(0.0, arma::datum::inf, thetaOld(K+2), proposalScale * rwmhSd(K+2), true);
         break; 
 
     } 
     for (unsigned int k=0; k<K+1; k++)
     {
-      thetaProp(k) = gaussian::rtnorm(-1.0, 1.0, thetaOld(k), proposalScale * rwmhSd(k));
+      thetaProp(k) = gaussian::rtnorm(-1.0, 1.0, thetaOld(k), proposalScale * rwmhSd(k), true);
     }
   }
   /// Evaluates the log-unnormalised proposal density
@@ -2801,6 +2704,34 @@ private:
     }
   }
   
+  /// Performs multinomial resampling within the $j$th block of the 
+  /// blocked particle filter at Step t and returns the log-normalising 
+  /// constant of the local weights. Only local copies of the block 
+  /// borders and a block-specific random-number stream are used so 
+  /// that different blocks can be processed concurrently.
+  void resampleBlock(
+    const unsigned int j, 
+    const unsigned int t, 
+    const arma::mat& particlesNew, 
+    arma::mat& particlesOld, 
+    double& logZ, 
+    std::mt19937& engine)
+  {
+    const unsigned int lInnB = blockInn(0,j);
+    const unsigned int uInnB = blockInn(1,j);
+    
+    arma::colvec logWeights;
+    computeLocalWeights(logWeights, t-1, lInnB, uInnB);
+    arma::colvec cumW = arma::cumsum(normaliseWeights(logWeights, logZ)); // cumulative self-normalised weights for the jth block
+    
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    unsigned int parentIndex;
+    for (unsigned int n=0; n<N; n++)
+    {
+      parentIndex = std::min(static_cast<unsigned int>(std::lower_bound(cumW.begin(), cumW.end(), unif(engine)) - cumW.begin()), N-1);
+      particlesOld(arma::span(lInnB,uInnB), arma::span(n,n)) = particlesNew(arma::span(lInnB,uInnB), arma::span(parentIndex,parentIndex)); 
+    }
+  }
   /// Obtains the log of the local weights of a specific block.
   void computeLocalWeights(
     arma::colvec& logWeights,
@@ -3351,6 +3282,343 @@ private:
     }
   }
   
+  /// Performs "forward" smoothing using blocked backward kernels. The spatial
+  /// blocks are processed in parallel.
+  void runBlockedForwardSmoother()
+  {
+    #pragma omp parallel for num_threads(std::max(cores, 1u)) schedule(dynamic) if(nBlocks > 1)
+    for (unsigned int j=0; j<nBlocks; j++)
+    {
+      runBlockedForwardSmootherBlock(j);
+    }
+  }
+  /// Performs "forward" smoothing using blocked backward kernels for the 
+  /// $j$th block. The smoothed sufficient statistics associated with all 
+  /// $N$ particles are stored as the columns of a single matrix of 
+  /// stacked (and vectorised) statistics (H, Q, R, R1, S) so that 
+  /// the backward-kernel weighting reduces to a single matrix product. 
+  /// Only local copies of the block borders are used so that 
+  /// different blocks can be processed concurrently.
+  void runBlockedForwardSmootherBlock(const unsigned int j)
+  {
+    // Borders of the current block (see computeBlockParameters()):
+    const unsigned int lInnB    = blockInn(0,j);
+    const unsigned int uInnB    = blockInn(1,j);
+    const unsigned int lOutB    = blockOut(0,j);
+    const unsigned int uOutB    = blockOut(1,j);
+    const unsigned int lOutNeiB = (lOutB > K) ? lOutB - K : 0;
+    const unsigned int uOutNeiB = std::min(uOutB + K, V-1);
+    const unsigned int sizeB    = uInnB - lInnB + 1;
+    const unsigned int iZ       = ((K+1) * (K+2) + 3) * sizeB; // see initialiseAdditiveFunctionalsBlock()
+    
+    arma::mat alphaOld(iZ + (K+1) * sizeB, N);
+    arma::mat alphaNew(iZ + (K+1) * sizeB, N);
+    arma::mat backwardKernels(N, N); // (m,n)th element: backward kernel evaluated at the mth time-(t-1) particle given the nth time-t particle
+    arma::colvec logWeights(N);
+    
+    // Cholesky factor of the transition covariance matrix restricted to the extended block:
+    const arma::mat cholSigma = arma::chol(BBT(arma::span(lOutB, uOutB), arma::span(lOutB, uOutB)));
+    arma::mat zOld, zNew; // "whitened" means and particles
+    
+    initialiseAdditiveFunctionalsBlock(alphaOld, lInnB, sizeB);
+    
+    for (unsigned int t=1; t<T; t++)
+    {
+      // Log-backward kernels: terms which are constant in m cancel in the normalisation.
+      computeLocalWeights(logWeights, t-1, lOutNeiB, uOutNeiB);
+      zOld = arma::solve(arma::trimatl(cholSigma.t()), 
+        A(arma::span(lOutB, uOutB), arma::span(lOutNeiB, uOutNeiB)) * particlesFull.slice(t-1).rows(lOutNeiB, uOutNeiB));
+      zNew = arma::solve(arma::trimatl(cholSigma.t()), particlesFull.slice(t).rows(lOutB, uOutB));
+      logWeights = logWeights - 0.5 * arma::trans(arma::sum(zOld % zOld, 0));
+      backwardKernels = zOld.t() * zNew;
+      
+      #pragma omp parallel for num_threads(std::max(cores, 1u)) schedule(static)
+      for (unsigned int n=0; n<N; n++)
+      {
+        double* kernel = backwardKernels.colptr(n);
+        double kernelMax = -std::numeric_limits<double>::infinity();
+        for (unsigned int m=0; m<N; m++)
+        {
+          kernel[m] += logWeights(m);
+          kernelMax = std::max(kernelMax, kernel[m]);
+        }
+        double kernelSum = 0.0;
+        for (unsigned int m=0; m<N; m++)
+        {
+          kernel[m] = std::exp(kernel[m] - kernelMax);
+          kernelSum += kernel[m];
+        }
+        for (unsigned int m=0; m<N; m++)
+        {
+          kernel[m] /= kernelSum;
+        }
+      }
+      
+      addAdditiveFunctionalsOldBlock(alphaOld, t, lInnB, sizeB);
+      
+      // Backward-kernel weighting of all statistics:
+      alphaNew = alphaOld * backwardKernels;
+      
+      addAdditiveFunctionalsNewBlock(alphaNew, t, lInnB, sizeB);
+      alphaOld.swap(alphaNew);
+    }
+    
+    computeLocalWeights(logWeights, T-1, lOutB, uOutB); // calculates the local weights
+    storeAdditiveFunctionalsBlock(alphaOld.rows(0, iZ-1) * normaliseWeights(logWeights), lInnB, uInnB);
+  }
+  
+  /// Performs PaRIS-type smoothing (Olsson & Westerborn, 2017) of the 
+  /// additive sufficient statistics. For the blocked filter, each block 
+  /// uses blocked backward kernels; otherwise, a single block covering 
+  /// the whole state space is used together with the standard backward 
+  /// kernels.
+  void runParisSmoother()
+  {
+    for (unsigned int j=0; j<nBlocks; j++)
+    {
+      runParisSmootherBlock(j);
+    }
+  }
+  /// Performs PaRIS-type smoothing for the $j$th block. Instead of 
+  /// integrating over all $N$ time-(t-1) particles, the statistics of 
+  /// each time-t particle are averaged over $M$ indices drawn from the 
+  /// backward kernel (M = 2 is typically sufficient). As the Gaussian 
+  /// transition density is bounded by its value at the mode, the indices 
+  /// are obtained by rejection sampling with the filter weights as 
+  /// proposal; after $\sqrt{N}$ unsuccessful proposals, the backward 
+  /// kernel is evaluated exactly. The expected cost is then linear in N.
+  void runParisSmootherBlock(const unsigned int j)
+  {
+    // Borders of the current block (see computeBlockParameters()):
+    const unsigned int lInnB    = blockInn(0,j);
+    const unsigned int uInnB    = blockInn(1,j);
+    const unsigned int lOutB    = blockOut(0,j);
+    const unsigned int uOutB    = blockOut(1,j);
+    const unsigned int lOutNeiB = (lOutB > K) ? lOutB - K : 0;
+    const unsigned int uOutNeiB = std::min(uOutB + K, V-1);
+    const unsigned int sizeB    = uInnB - lInnB + 1;
+    const unsigned int iZ       = ((K+1) * (K+2) + 3) * sizeB; // see initialiseAdditiveFunctionalsBlock()
+    
+    const unsigned int nProposalsMax = std::max(static_cast<unsigned int>(std::sqrt(N)), 1u);
+    
+    arma::mat alphaOld(iZ + (K+1) * sizeB, N);
+    arma::mat alphaNew(iZ + (K+1) * sizeB, N);
+    arma::colvec logWeights(N);
+    arma::colvec cumW(N); // cumulative self-normalised filter weights
+    arma::colvec logKernel(N);
+    unsigned int b; // index of a time-(t-1) particle drawn from the backward kernel
+    bool isAccepted;
+    
+    // Cholesky factor of the transition covariance matrix restricted to the extended block:
+    const arma::mat cholSigma = arma::chol(BBT(arma::span(lOutB, uOutB), arma::span(lOutB, uOutB)));
+    arma::mat zOld, zNew; // "whitened" means and particles
+    
+    initialiseAdditiveFunctionalsBlock(alphaOld, lInnB, sizeB);
+    
+    for (unsigned int t=1; t<T; t++)
+    {
+      if (filt == SMC_FILTER_BLOCK)
+      {
+        computeLocalWeights(logWeights, t-1, lOutNeiB, uOutNeiB);
+      }
+      else
+      {
+        logWeights = logWeightsFull.col(t-1);
+      }
+      cumW = arma::cumsum(normaliseWeights(logWeights));
+      zOld = arma::solve(arma::trimatl(cholSigma.t()), 
+        A(arma::span(lOutB, uOutB), arma::span(lOutNeiB, uOutNeiB)) * particlesFull.slice(t-1).rows(lOutNeiB, uOutNeiB));
+      zNew = arma::solve(arma::trimatl(cholSigma.t()), particlesFull.slice(t).rows(lOutB, uOutB));
+      
+      addAdditiveFunctionalsOldBlock(alphaOld, t, lInnB, sizeB);
+      alphaNew.zeros();
+      
+      for (unsigned int n=0; n<N; n++)
+      {
+        for (unsigned int i=0; i<M; i++)
+        {
+          isAccepted = false;
+          for (unsigned int a=0; a<nProposalsMax && !isAccepted; a++)
+          {
+            b = std::min(static_cast<unsigned int>(std::lower_bound(cumW.begin(), cumW.end(), arma::randu()) - cumW.begin()), N-1);
+            isAccepted = std::log(arma::randu()) < -0.5 * arma::accu(arma::square(zNew.col(n) - zOld.col(b)));
+          }
+          if (!isAccepted)
+          {
+            logKernel = logWeights - 0.5 * arma::trans(arma::sum(arma::square(zOld.each_col() - zNew.col(n)), 0));
+            b = sampleInt(normaliseWeights(logKernel));
+          }
+          alphaNew.col(n) += alphaOld.col(b);
+        }
+      }
+      alphaNew = alphaNew / M;
+      
+      addAdditiveFunctionalsNewBlock(alphaNew, t, lInnB, sizeB);
+      alphaOld.swap(alphaNew);
+    }
+    
+    if (filt == SMC_FILTER_BLOCK)
+    {
+      computeLocalWeights(logWeights, T-1, lOutB, uOutB);
+    }
+    else
+    {
+      logWeights = logWeightsFull.col(T-1);
+    }
+    storeAdditiveFunctionalsBlock(alphaOld.rows(0, iZ-1) * normaliseWeights(logWeights), lInnB, uInnB);
+  }
+  
+  /// Performs the PaRIS update of the additive functionals of the current 
+  /// block in the online gradient-ascent algorithms: alphaNew.col(n) is the 
+  /// average of alphaOld.col(b) plus the additive functional (restricted to 
+  /// the components lAdd, ..., uAdd) over M indices b drawn from the backward 
+  /// kernel of the nth time-t particle. The backward kernel uses the 
+  /// self-normalised weights w and the transition density of the components 
+  /// lB, ..., uB (given the components lNei, ..., uNei). The indices are 
+  /// drawn as in runParisSmootherBlock() so that the cost per time step is 
+  /// linear in N (rather than quadratic).
+  void updateAdditiveFunctionalsParis(
+    arma::mat& alphaNew, 
+    const arma::mat& alphaOld, 
+    const unsigned int t, 
+    const arma::mat& particlesNew, 
+    const arma::mat& particlesOld, 
+    const arma::colvec& w,
+    const unsigned int lB, const unsigned int uB, 
+    const unsigned int lNei, const unsigned int uNei, 
+    const unsigned int lAdd, const unsigned int uAdd)
+  {
+    const unsigned int nProposalsMax = std::max(static_cast<unsigned int>(std::sqrt(N)), 1u);
+    const arma::colvec cumW = arma::cumsum(w);
+    const arma::colvec logW = arma::log(w);
+    arma::colvec myZeros(K, arma::fill::zeros);
+    arma::colvec logKernel(N);
+    unsigned int b; // index of a time-(t-1) particle drawn from the backward kernel
+    bool isAccepted;
+    
+    // "Whitened" means and particles (the transition covariance matrix is B(0,0)^2 times the identity):
+    const arma::mat zOld = A(arma::span(lB, uB), arma::span(lNei, uNei)) * particlesOld.rows(lNei, uNei) / B(0,0);
+    const arma::mat zNew = particlesNew.rows(lB, uB) / B(0,0);
+    
+    alphaNew.zeros();
+    for (unsigned int n=0; n<N; n++)
+    {
+      for (unsigned int i=0; i<M; i++)
+      {
+        isAccepted = false;
+        for (unsigned int a=0; a<nProposalsMax && !isAccepted; a++)
+        {
+          b = std::min(static_cast<unsigned int>(std::lower_bound(cumW.begin(), cumW.end(), arma::randu()) - cumW.begin()), N-1);
+          isAccepted = std::log(arma::randu()) < -0.5 * arma::accu(arma::square(zNew.col(n) - zOld.col(b)));
+        }
+        if (!isAccepted)
+        {
+          logKernel = logW - 0.5 * arma::trans(arma::sum(arma::square(zOld.each_col() - zNew.col(n)), 0));
+          b = sampleInt(normaliseWeights(logKernel));
+        }
+        alphaNew.col(n) += alphaOld.col(b) + 
+          additiveFunction(t, particlesNew.col(n), arma::join_cols(arma::join_cols(myZeros, particlesOld.col(b)), myZeros), lAdd, uAdd);
+      }
+    }
+    alphaNew = alphaNew / M;
+  }
+  
+  /// Initialises the smoothed sufficient statistics of the block with  
+  /// inner borders lInnB and lInnB+sizeB-1 at time 0. Each column of alpha 
+  /// stacks the (vectorised) statistics H, Q, R, R1, S associated with 
+  /// one particle, followed by (K+1)*sizeB rows which hold the additive 
+  /// functionals of the time-(t-1) particle.
+  void initialiseAdditiveFunctionalsBlock(arma::mat& alpha, const unsigned int lInnB, const unsigned int sizeB)
+  {
+    const unsigned int iR  = (K+1) * (K+2) * sizeB;
+    const unsigned int iR1 = iR + sizeB;
+    const unsigned int iS  = iR1 + sizeB;
+    
+    alpha.zeros();
+    for (unsigned int n=0; n<N; n++)
+    {
+      for (unsigned int v=0; v<sizeB; v++)
+      {
+        alpha(iR+v,n) = particlesFull(lInnB+v,n,0) * particlesFull(lInnB+v,n,0);
+        alpha(iS+v,n) = particlesFull(lInnB+v,n,0) * y(lInnB+v,0);
+      }
+    }
+    alpha.rows(iR1, iR1+sizeB-1) = alpha.rows(iR, iR+sizeB-1);
+  }
+  /// Adds the additive functionals which only depend on the time-(t-1) 
+  /// particles (padded by zeros to avoid issues on the boundary of the 
+  /// state space) to the stacked statistics.
+  void addAdditiveFunctionalsOldBlock(arma::mat& alpha, const unsigned int t, const unsigned int lInnB, const unsigned int sizeB)
+  {
+    const unsigned int iZ = ((K+1) * (K+2) + 3) * sizeB;
+    
+    #pragma omp parallel for num_threads(std::max(cores, 1u)) schedule(static)
+    for (unsigned int m=0; m<N; m++)
+    {
+      double* a = alpha.colptr(m);
+      double* z = a + iZ;
+      for (unsigned int v=0; v<sizeB; v++)
+      {
+        z[v*(K+1)] = particlesFull(lInnB+v,m,t-1);
+        for (unsigned int k=1; k<K+1; k++)
+        {
+          z[k+v*(K+1)] = 
+            (lInnB+v >= k ? particlesFull(lInnB+v-k,m,t-1) : 0.0) + 
+            (lInnB+v+k < V ? particlesFull(lInnB+v+k,m,t-1) : 0.0);
+        }
+        for (unsigned int l=0; l<K+1; l++)
+        {
+          for (unsigned int k=0; k<K+1; k++)
+          {
+            a[k+(l+v*(K+1))*(K+1)] += z[k+v*(K+1)] * z[l+v*(K+1)];
+          }
+        }
+      }
+    }
+  }
+  /// Adds the additive functionals which depend on the time-t particles
+  /// to the (backward-kernel weighted) stacked statistics.
+  void addAdditiveFunctionalsNewBlock(arma::mat& alpha, const unsigned int t, const unsigned int lInnB, const unsigned int sizeB)
+  {
+    const unsigned int nH = (K+1) * (K+1) * sizeB;
+    const unsigned int iR = nH + (K+1) * sizeB;
+    const unsigned int iS = iR + 2 * sizeB;
+    const unsigned int iZ = iS + sizeB;
+    
+    #pragma omp parallel for num_threads(std::max(cores, 1u)) schedule(static)
+    for (unsigned int n=0; n<N; n++)
+    {
+      double* a = alpha.colptr(n);
+      double x;
+      for (unsigned int v=0; v<sizeB; v++)
+      {
+        x = particlesFull(lInnB+v,n,t);
+        for (unsigned int k=0; k<K+1; k++)
+        {
+          a[nH+k+v*(K+1)] += x * a[iZ+k+v*(K+1)];
+        }
+        a[iR+v] += x * x;
+        a[iS+v] += x * y(lInnB+v,t);
+      }
+    }
+  }
+  /// Writes the estimates of the stacked statistics of the block 
+  /// with inner borders lInnB and uInnB into the component-wise estimates.
+  void storeAdditiveFunctionalsBlock(const arma::colvec& alphaEst, const unsigned int lInnB, const unsigned int uInnB)
+  {
+    const unsigned int sizeB = uInnB - lInnB + 1;
+    const unsigned int nH  = (K+1) * (K+1) * sizeB;
+    const unsigned int iR  = nH + (K+1) * sizeB;
+    const unsigned int iR1 = iR + sizeB;
+    const unsigned int iS  = iR1 + sizeB;
+    
+    suffHCompEst.slices(lInnB, uInnB)  = arma::cube(alphaEst.memptr(), K+1, K+1, sizeB);
+    suffQCompEst.cols(lInnB, uInnB)    = arma::reshape(alphaEst.subvec(nH, iR-1), K+1, sizeB);
+    suffRCompEst.subvec(lInnB, uInnB)  = alphaEst.subvec(iR, iR1-1);
+    suffR1CompEst.subvec(lInnB, uInnB) = alphaEst.subvec(iR1, iS-1);
+    suffSCompEst.subvec(lInnB, uInnB)  = alphaEst.subvec(iS, iS+sizeB-1);
+  }
+  
   /////////////////////////////////////////////////////////////////////////////
   // Variables:
   /////////////////////////////////////////////////////////////////////////////
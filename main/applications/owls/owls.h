@@ -308,6 +308,15 @@ public:
   /// Returns the parameter vector $\phi_{A,m,i}$.
   double getPhiMaleAdult(const unsigned int i) const {return phiMaleAdult_(i);}
   
+  /// Returns the matrix of multinomial cell probabilities for first-year females.
+  const arma::mat& getQFemaleFirst() const {return qFemaleFirst_;}
+  /// Returns the matrix of multinomial cell probabilities for adult females.
+  const arma::mat& getQFemaleAdult() const {return qFemaleAdult_;}
+  /// Returns the matrix of multinomial cell probabilities for first-year males.
+  const arma::mat& getQMaleFirst() const {return qMaleFirst_;}
+  /// Returns the matrix of multinomial cell probabilities for adult males.
+  const arma::mat& getQMaleAdult() const {return qMaleAdult_;}
+  
   /// Returns the relevant elements of the parameter vector $\q_{1,f,i}$.
   arma::colvec getQFemaleFirst(const unsigned int t) const 
   {
@@ -552,6 +561,25 @@ public:
   /// Returns the number of adult females released in year $t$.
   unsigned int getReleasedMaleAdult(const unsigned int t) const { return releasedMaleAdult_(t); }
   
+  /// Returns the log-likelihood of the capture-recapture data given the 
+  /// matrices of multinomial cell probabilities. The data-dependent 
+  /// quantities are computed only at the first call.
+  double evaluateLogLikelihoodCapRecap(const arma::mat& qFemaleFirst, const arma::mat& qFemaleAdult, const arma::mat& qMaleFirst, const arma::mat& qMaleAdult)
+  {
+    if (!capRecapFemaleFirstLikelihood_.isInitialised())
+    {
+      // NOTE: only the cells to the right of the main diagonal are used.
+      capRecapFemaleFirstLikelihood_.setData(capRecapFemaleFirst_, releasedFemaleFirst_, true);
+      capRecapFemaleAdultLikelihood_.setData(capRecapFemaleAdult_, releasedFemaleAdult_, true);
+      capRecapMaleFirstLikelihood_.setData(capRecapMaleFirst_, releasedMaleFirst_, true);
+      capRecapMaleAdultLikelihood_.setData(capRecapMaleAdult_, releasedMaleAdult_, true);
+    }
+    return capRecapFemaleFirstLikelihood_.evaluate(qFemaleFirst) + 
+           capRecapFemaleAdultLikelihood_.evaluate(qFemaleAdult) + 
+           capRecapMaleFirstLikelihood_.evaluate(qMaleFirst) + 
+           capRecapMaleAdultLikelihood_.evaluate(qMaleAdult);
+  }
+  
   arma::uvec releasedFemaleFirst_; // length-$(T-1)$ vector total number of female first-years released in each year (again, not data on the number of individuals released at time $T$ is included here since there is not recapture data on these).
   arma::uvec releasedMaleFirst_; // length-$(T-1)$ vector of total number of male first-years released in each year.
   arma::uvec releasedFemaleAdult_; // length-$(T-1)$ vector of total number of female adults released in each year.
@@ -562,6 +590,11 @@ public:
   arma::umat capRecapFemaleAdult_; // same as above but for female adults
   arma::umat capRecapMaleAdult_; // same as above but for male adults
   
+  MultinomialLikelihood capRecapFemaleFirstLikelihood_; // precomputed data-dependent quantities of the multinomial likelihood for first-year females
+  MultinomialLikelihood capRecapFemaleAdultLikelihood_; // same as above but for female adults
+  MultinomialLikelihood capRecapMaleFirstLikelihood_; // same as above but for male first-years
+  MultinomialLikelihood capRecapMaleAdultLikelihood_; // same as above but for male adults
+  
   arma::uvec count_; // length-T vector of count data
   arma::umat fecundity_; // (T,2) matrix of fecundity data (the first column represents the number of chicks that survive to leave the nest and the second column is the number of chicks that are produced).
 
@@ -737,14 +770,10 @@ double Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Obser
     logLike += R::dpois(observations_.fecundity_(t,1), observations_.fecundity_(t,0) * modelParameters_.getRho(t), true);
   }
   // Likelihood based on capture--recapture data
-  for (unsigned int t=0; t<nObservations_-1; t++)
-  {
-    // TODO: we need to only use the columns that are to the right of the main diagonal!
-    logLike += logMultinomialDensity(observations_.getCapRecapFemaleFirst(t), observations_.getReleasedFemaleFirst(t), modelParameters_.getQFemaleFirst(t));
-    logLike += logMultinomialDensity(observations_.getCapRecapFemaleAdult(t), observations_.getReleasedFemaleAdult(t), modelParameters_.getQFemaleAdult(t)); 
-    logLike += logMultinomialDensity(observations_.getCapRecapMaleFirst(t), observations_.getReleasedMaleFirst(t), modelParameters_.getQMaleFirst(t)); 
-    logLike += logMultinomialDensity(observations_.getCapRecapMaleAdult(t), observations_.getReleasedMaleAdult(t), modelParameters_.getQMaleAdult(t)); 
-  }
+  logLike += observations_.evaluateLogLikelihoodCapRecap(
+    modelParameters_.getQFemaleFirst(), modelParameters_.getQFemaleAdult(), 
+    modelParameters_.getQMaleFirst(), modelParameters_.getQMaleAdult()
+  );
   return logLike;
 }
 
@@ -761,10 +790,7 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
   const std::vector<Particle>& particlesOld
 )
 {
-  for (unsigned int n=0; n<getNParticles(); n++)
-  {
-    particlesNew[n] = model_.sampleFromTransitionEquation(t, particlesOld[n]);
-  }
+  model_.sampleFromTransitionEquation(t, particlesNew, particlesOld);
   if (isConditional_) {particlesNew[particleIndicesIn_(t)] = particlePath_[t];}
 }
 /// Computes a particle weight at Step 0.
@@ -777,10 +803,9 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
   arma::colvec& logWeights
 )
 {
-  for (unsigned int n=0; n<getNParticles(); n++)
-  {
-    logWeights(n) += model_.evaluateLogObservationDensity(t, particlesNew[n]);
-  }
+  arma::colvec& logObservationDensities = workspace_.logIncrementalWeights_;
+  model_.evaluateLogObservationDensity(t, particlesNew, logObservationDensities);
+  logWeights += logObservationDensities;
 }
 /// Reparametrises particles at Step 0 to obtain the values of Gaussian random variables.
 template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class SmcParameters> 
@@ -14,6 +14,7 @@
 #include "main/algorithms/mcmc/Mcmc.h"
 #include "main/rng/gaussian.h"
 #include "main/helperFunctions/envelope.h"
+#include "main/helperFunctions/rqmc.h"
 #include "main/helperFunctions/rootFinding.h"
 
 // [[Rcpp::depends("RcppArmadillo")]]
@@ -183,6 +184,10 @@ public:
   const arma::colvec& getProbabilities() const {return probabilities_;};
   /// Returns number of support points of the envelope.
   unsigned int getnPoints() const {return nPoints_;};
+  /// Returns the type of (randomised quasi-Monte Carlo) point set used for sampling the envelope.
+  RqmcType getRqmcType() const {return rqmcType_;};
+  /// Specifies the type of (randomised quasi-Monte Carlo) point set used for sampling the envelope.
+  void setRqmcType(const RqmcType rqmcType) {rqmcType_ = rqmcType;};
   
   /// Returns the support points of the envelope.
   arma::colvec& getRefPoints() {return points_;};
@@ -197,6 +202,7 @@ private:
   arma::colvec levels_; // unnormalised levels forming the envelope
   arma::colvec probabilities_; // probabilities of falling in each of the piecewise-linear sections of the proposal density
   unsigned int nPoints_ = 50; // number of support points for adaptive envelope
+  RqmcType rqmcType_ = RQMC_NONE; // type of point set used for sampling the envelope
  
 };
 /// Holds some additional auxiliary parameters for the SMC algorithm.
@@ -342,9 +348,12 @@ void Smc<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observati
   // Samples the envelope:
   envelope::create(smcParameters_.getRefPoints(), smcParameters_.getRefLevels(), smcParameters_.getRefProbabilities(), logDensity, smcParameters_.getnPoints(), lb, ub, mode, isBracketing); 
 
+  // The particles are sampled independently of their parents so that the 
+  // uniforms may be taken from a randomised quasi-Monte Carlo point set:
+  arma::rowvec u = rqmc::sample(getNParticles(), 1, smcParameters_.getRqmcType());
   for (unsigned int n=0; n<getNParticles(); n++)
   {
-    particlesNew[n] = envelope::sample(smcParameters_.getPoints(), smcParameters_.getLevels(), smcParameters_.getProbabilities());
+    particlesNew[n] = envelope::sample(smcParameters_.getPoints(), smcParameters_.getLevels(), smcParameters_.getProbabilities(), u(n));
   }
   if (isConditional_) {particlesNew[particleIndicesIn_(t)] = particlePath_[t];}
 }
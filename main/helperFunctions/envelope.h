@@ -21,46 +21,46 @@
 
 namespace envelope
 {
-  /// Samples from the envelope.
+  /// Samples from the envelope by inverting its distribution function at 
+  /// the uniform u. As the map is monotone, u may be taken from a 
+  /// randomised quasi-Monte Carlo point set (see rqmc.h).
   double sample(
     const arma::colvec& points, 
     const arma::colvec& levels,
-    const arma::colvec& probabilities
+    const arma::colvec& probabilities,
+    const double u
   )
   {
+    // Determining the interval:
+    unsigned int nIntervals = probabilities.size();
+    unsigned int idx = 0;
+    double cumProbability = probabilities(0);
+    while (cumProbability < u && idx < nIntervals - 1)
+    {
+      idx++;
+      cumProbability += probabilities(idx);
+    }
+    double v  = 0.0; // uniform within the interval
+    if (probabilities(idx) > 0)
+    {
+      v = std::min(std::max((u - (cumProbability - probabilities(idx))) / probabilities(idx), 0.0), 1.0);
+    }
     
-//     std::cout << "started sample()" <<std::endl;
-    
-    // TODO: we could probably use randomised QMC point sets (a la systematic resampling) here. To do this,
-    // we need to make this function take a single uniform as an extra argument and then wrap it in 
-    // another function which creates a systematic-resampling-like set of N QMC points. The marginal
-    // proposal distributions will remain unaffected
-    
-    unsigned int idx = sampleInt(probabilities);
     double a  = points(idx);
     double b  = points(idx+1);
     double Z  = (b-a)*(levels(idx) + (levels(idx+1)-levels(idx))/2.0); // normalising constant for the specific interval
     double fa = levels(idx) / Z;
     double fb = levels(idx+1) / Z;
     double slope = (fb - fa) / (b - a);
-
-    double x = a + fa/slope + std::sqrt(2.0/slope*arma::randu() + std::pow((fa/slope), 2.0));
     
-    if (arma::randu() <= std::min(fa,fb)*(b-a))
-    {
-      x = a + (b-a)*arma::randu();
-    }
-    else 
+    // Solving fa*(x-a) + slope*(x-a)^2/2 = v in a numerically stable manner:
+    double denominator = fa + std::sqrt(std::max(fa*fa + 2.0*slope*v, 0.0));
+    double x = a;
+    if (denominator > 0)
     {
-      if (fa <= fb)
-      {
-        x = a + std::sqrt(arma::randu()) * (b-a);
-      }
-      else
-      {
-        x = b - std::sqrt(arma::randu()) * (b-a);
-      }
+      x = a + 2.0 * v / denominator;
     }
+    
     /////////////////////
           if (x<a) 
           {
@@ -71,9 +71,17 @@ namespace envelope
             std::cout << "################## Warning: sampled x > b  " << x << " > " << b << "  #####################" << std::endl;
           }   
     ////////////////////
-//     std::cout << "finished sample()" <<std::endl;
     return x;
   }
+  /// Samples from the envelope.
+  double sample(
+    const arma::colvec& points, 
+    const arma::colvec& levels,
+    const arma::colvec& probabilities
+  )
+  {
+    return sample(points, levels, probabilities, arma::randu());
+  }
   /// Normalises the envelope.
   void normaliseLevels(
     const unsigned int nPoints, // number of current points
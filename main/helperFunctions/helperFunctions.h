@@ -22,27 +22,135 @@
 /// (i.e. outputs a value in {0, ..., length(W)-1}).
 unsigned int sampleInt(const arma::colvec& W) 
 { 
-  unsigned int x = arma::conv_to<unsigned int>::from(arma::find(arma::cumsum(W) >= arma::randu(), 1, "first"));
-  return x;
+  double u = arma::randu();
+  double cumW = 0.0;
+  for (unsigned int i=0; i<W.size(); i++)
+  {
+    cumW += W(i);
+    if (cumW >= u) {return i;}
+  }
+  return W.size() - 1;
 }
 /// Samples a single value from a multinomial distribution (with size $1$)
 /// (i.e. outputs a value in {0, ..., length(W)-1}).
 unsigned int sampleInt(const arma::rowvec& W) 
 { 
-  unsigned int x = arma::conv_to<unsigned int>::from(arma::find(arma::cumsum(W) >= arma::randu(), 1, "first"));
-  return x;
+  double u = arma::randu();
+  double cumW = 0.0;
+  for (unsigned int i=0; i<W.size(); i++)
+  {
+    cumW += W(i);
+    if (cumW >= u) {return i;}
+  }
+  return W.size() - 1;
 }
+/// Samples repeatedly from a multinomial distribution (with size $1$) 
+/// with fixed weights W (i.e. outputs values in {0, ..., length(W)-1}).
+/// Draws either use binary search on the cumulative weights 
+/// (O(log K) per draw) or, if sufficiently many draws are requested 
+/// to amortise its set-up cost, a Walker/Vose alias table (O(1) per draw).
+class CategoricalSampler
+{
+public:
+  
+  /// Initialises the class.
+  CategoricalSampler() : nCategories_(0), useAliasTable_(false) {}
+  /// Initialises the class with (not necessarily normalised) weights W 
+  /// and the (approximate) number of draws which will be requested.
+  CategoricalSampler(const arma::colvec& W, const unsigned int nDraws = 1)
+  {
+    setWeights(W, nDraws);
+  }
+  
+  /// Specifies the (not necessarily normalised) weights W and the
+  /// (approximate) number of draws which will be requested.
+  void setWeights(const arma::colvec& W, const unsigned int nDraws = 1)
+  {
+    nCategories_ = W.size();
+    useAliasTable_ = nCategories_ > 1 && 
+      static_cast<double>(nDraws) * std::log2(static_cast<double>(nCategories_)) > 2.0 * nCategories_;
+    
+    if (useAliasTable_)
+    {
+      computeAliasTable(W);
+    }
+    else
+    {
+      cumW_ = arma::cumsum(W) / arma::accu(W);
+    }
+  }
+  /// Returns true if draws use the alias table.
+  bool getUseAliasTable() const {return useAliasTable_;}
+  
+  /// Samples a single value.
+  unsigned int sample() const
+  {
+    if (useAliasTable_)
+    {
+      double u = arma::randu() * nCategories_;
+      unsigned int i = std::min(static_cast<unsigned int>(u), nCategories_ - 1);
+      return (u - i < prob_(i)) ? i : alias_(i);
+    }
+    else
+    {
+      return std::min(static_cast<unsigned int>(std::lower_bound(cumW_.begin(), cumW_.end(), arma::randu()) - cumW_.begin()), nCategories_ - 1);
+    }
+  }
+  /// Samples n values.
+  arma::uvec sample(const unsigned int n) const
+  {
+    arma::uvec x(n);
+    for (unsigned int i=0; i<n; i++)
+    {
+      x(i) = sample();
+    }
+    return x;
+  }
+  
+private:
+  
+  /// Computes the alias table via Vose's algorithm.
+  void computeAliasTable(const arma::colvec& W)
+  {
+    prob_ = W * (nCategories_ / arma::accu(W));
+    alias_ = arma::linspace<arma::uvec>(0, nCategories_ - 1, nCategories_);
+    
+    std::vector<unsigned int> small, large;
+    small.reserve(nCategories_);
+    large.reserve(nCategories_);
+    for (unsigned int i=0; i<nCategories_; i++)
+    {
+      if (prob_(i) < 1.0) {small.push_back(i);}
+      else {large.push_back(i);}
+    }
+    
+    unsigned int s, l;
+    while (!small.empty() && !large.empty())
+    {
+      s = small.back(); small.pop_back();
+      l = large.back(); large.pop_back();
+      alias_(s) = l;
+      prob_(l) = (prob_(l) + prob_(s)) - 1.0;
+      if (prob_(l) < 1.0) {small.push_back(l);}
+      else {large.push_back(l);}
+    }
+    // Remaining probabilities are equal to 1 up to rounding errors:
+    for (unsigned int i=0; i<large.size(); i++) {prob_(large[i]) = 1.0;}
+    for (unsigned int i=0; i<small.size(); i++) {prob_(small[i]) = 1.0;}
+  }
+  
+  unsigned int nCategories_; // number of categories
+  bool useAliasTable_; // should draws use the alias table (rather than binary search)?
+  arma::colvec cumW_; // self-normalised cumulative weights
+  arma::colvec prob_; // acceptance probabilities of the alias table
+  arma::uvec alias_; // aliases of the alias table
+  
+};
 /// Samples multiple values from a multinomial distribution (with size $1$)
 /// (i.e. outputs N values in {0, ..., length(W)-1})
 arma::uvec sampleInt(unsigned int N, const arma::colvec& W) 
 { 
-  arma::colvec cumW = arma::cumsum(W);
-  arma::uvec x(N);
-  for (unsigned int n=0; n<N; n++)
-  {
-    x(n) =  arma::conv_to<unsigned int>::from(arma::find(cumW >= arma::randu(), 1, "first"));
-  }
-  return x;
+  return CategoricalSampler(W, N).sample(N);
 }
 /// Normalise a single distribution in log-space (returns 
 /// normalised weights in log space).
@@ -115,6 +223,29 @@ void convertStdVecToArmaMat(const std::vector<arma::uvec>& x, arma::umat& y)
     y.col(t) = x[t];
   }
 }
+/// Converts a std::vector<arma::vec::fixed<N>> of length T 
+/// to an (N,T)-dimensional arma::mat.
+template <arma::uword N> void convertStdVecToArmaMat(const std::vector<arma::vec::fixed<N>>& x, arma::mat& y)
+{
+  unsigned int T = x.size();
+  
+  y.set_size(N, T);
+  for (unsigned int t=0; t<T; t++)
+  {
+    y.col(t) = x[t];
+  }
+}
+/// Converts an (N,T)-dimensional arma::mat to 
+/// a std::vector<arma::vec::fixed<N>> of length T.
+template <arma::uword N> void convertArmaMatToStdVec(const arma::mat& y, std::vector<arma::vec::fixed<N>>& x)
+{
+  unsigned int T = y.n_cols;
+  x.resize(T);
+  for (unsigned int t=0; t<T; t++)
+  {
+    x[t] = y.col(t);
+  }
+}
 /// Converts an (N,T)-dimensional arma::mat to 
 /// a std::vector<arma::colvec> of length T.
 void convertArmaMatToStdVec(const arma::mat& y, std::vector<arma::colvec>& x)
@@ -199,6 +330,115 @@ double logMultinomialDensity(const arma::urowvec& x, const unsigned int n, const
 
   return sumAux + std::lgamma(n+1) - arma::accu(arma::lgamma(x+1)); 
 }
+/// Log-likelihood of a collection of independent multinomial observations
+/// (e.g. the rows of a capture-recapture or ring-recovery matrix) for which
+/// the data stay fixed while the cell probabilities change. The normalising
+/// constants and the non-zero cells are determined once so that each
+/// evaluation only requires the terms $x_{i,j} \log p_{i,j}$ with $x_{i,j} > 0$.
+class MultinomialLikelihood
+{
+public:
+
+  /// Constructs an empty object (setData() needs to be called before use).
+  MultinomialLikelihood() : isInitialised_(false), logNormalisingConstant_(0.0) {}
+  /// Constructs the object from a matrix whose $i$th row contains the
+  /// counts of the $i$th multinomial observation which has size n(i).
+  MultinomialLikelihood(const arma::umat& x, const arma::uvec& n, const bool isUpperTriangular = false)
+  {
+    setData(x, n, isUpperTriangular);
+  }
+
+  /// Precomputes the data-dependent quantities. If isUpperTriangular is true,
+  /// only the cells on or to the right of the main diagonal are used (this is
+  /// the case for capture-recapture data where the $i$th row only has
+  /// support on the columns $i, i+1, \dotsc$).
+  void setData(const arma::umat& x, const arma::uvec& n, const bool isUpperTriangular = false)
+  {
+    nRows_ = x.n_rows;
+    nCols_ = x.n_cols;
+    logNormalisingConstant_ = 0.0;
+
+    unsigned int nCells = 0;
+    for (unsigned int j=0; j<nCols_; j++)
+    {
+      for (unsigned int i=0; i<nRows_; i++)
+      {
+        if ((!isUpperTriangular || j >= i) && x(i,j) > 0)
+        {
+          nCells++;
+        }
+      }
+    }
+    cellIndices_.set_size(nCells);
+    cellCounts_.set_size(nCells);
+
+    unsigned int k = 0;
+    for (unsigned int j=0; j<nCols_; j++)
+    {
+      for (unsigned int i=0; i<nRows_; i++)
+      {
+        if ((!isUpperTriangular || j >= i) && x(i,j) > 0)
+        {
+          cellIndices_(k) = i + j * nRows_; // column-major storage as in Armadillo
+          cellCounts_(k)  = static_cast<double>(x(i,j));
+          logNormalisingConstant_ -= std::lgamma(cellCounts_(k) + 1.0);
+          k++;
+        }
+      }
+    }
+    for (unsigned int i=0; i<nRows_; i++)
+    {
+      logNormalisingConstant_ += std::lgamma(static_cast<double>(n(i)) + 1.0);
+    }
+    isInitialised_ = true;
+  }
+  /// Discards the precomputed quantities, e.g. after the data have been changed.
+  void reset()
+  {
+    isInitialised_ = false;
+    cellIndices_.reset();
+    cellCounts_.reset();
+    logNormalisingConstant_ = 0.0;
+  }
+  /// Returns true if setData() has been called.
+  bool isInitialised() const {return isInitialised_;}
+  /// Returns the sum of the data-dependent terms
+  /// $\log n_i! - \sum_j \log x_{i,j}!$ over all observations.
+  double getLogNormalisingConstant() const {return logNormalisingConstant_;}
+  /// Returns the number of non-zero cells.
+  unsigned int getNCells() const {return cellIndices_.size();}
+
+  /// Returns the log of the unnormalised density. The $i$th row of the
+  /// (nRows, nCols)-matrix p contains the cell probabilities of the $i$th observation.
+  /// As in logMultinomialDensity(), cells with zero probability are ignored.
+  double evaluateUnnormalised(const arma::mat& p) const
+  {
+    const double* pMem = p.memptr();
+    double sumAux = 0.0;
+    for (unsigned int k=0; k<cellIndices_.size(); k++)
+    {
+      if (pMem[cellIndices_(k)] > 0.0)
+      {
+        sumAux += cellCounts_(k) * std::log(pMem[cellIndices_(k)]);
+      }
+    }
+    return sumAux;
+  }
+  /// Returns the log of the normalised density.
+  double evaluate(const arma::mat& p) const
+  {
+    return evaluateUnnormalised(p) + logNormalisingConstant_;
+  }
+
+private:
+
+  bool isInitialised_; // have the data-dependent quantities been computed?
+  unsigned int nRows_, nCols_; // dimensions of the data matrix
+  arma::uvec cellIndices_; // (column-major) linear indices of the non-zero cells
+  arma::colvec cellCounts_; // counts in the non-zero cells
+  double logNormalisingConstant_; // sum of the data-dependent terms of the log-density
+
+};
 
 /// Inverse of the logistic transform:
 arma::colvec inverseLogit(const arma::colvec& x)
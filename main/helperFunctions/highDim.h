@@ -80,7 +80,13 @@ namespace highDim
     
 //     std::cout << "Finished setting parameters!" << std::endl;
   }
-  /// Calculates the spatial-componentwise sufficient statistics.
+  /// Calculates the spatial-componentwise sufficient statistics. For each 
+  /// time step, the smoother gain is obtained via a Cholesky solve and the 
+  /// cross-covariance matrix of (x_t, x_{t-1}) is computed once. The 
+  /// (K+1, K+1)-dimensional statistics of the vth component then only 
+  /// require the band of (smoothed) second moments around v which is 
+  /// gathered via submatrix views. The spatial components are processed 
+  /// in parallel on nCores cores.
   void computeSuffComp(
     arma::cube& suffS1Comp,
     arma::mat& suffS2Comp,
@@ -99,85 +105,53 @@ namespace highDim
     const arma::mat& D, 
     const arma::mat& m0, 
     const arma::mat& C0, 
-    const arma::mat& y
+    const arma::mat& y,
+    const unsigned int nCores = 1
   )
   {
     unsigned int K = suffS2Comp.n_rows - 1; // number of non-zero off-diagonals of A on each side of the main diagonal
     unsigned int V = y.n_rows; // dimension of the states
     unsigned int T = y.n_cols; // number of time steps
     
-    arma::mat CSAux(2*K + V, 2*K + V, arma::fill::zeros);
-    arma::mat sigAux(2*V, 2*V);
-    arma::mat sigAuxExt(2*(V + K), 2*(V + K), arma::fill::zeros);
-    arma::colvec mExt(2*K + V, arma::fill::zeros);
-      
-    arma::mat HAux(K+1, K+1);
-    arma::colvec QAux(K+1);
-    double RAux, SAux;
-      
-    arma::mat Gk(V, V);
-    arma::mat P2(V, V);
-
+    arma::mat cholCP(V, V); // upper-triangular Cholesky factor of CP.slice(t)
+    arma::mat GkT(V, V); // transpose of the smoother gain
+    arma::mat crossCov(V, V); // covariance matrix of (x_t, x_{t-1}) under the smoothing distribution
+    
     for (unsigned int t=0; t<T; t++) 
     { 
-        
       if (t > 0)
       {
-        // Padding the covariance matrix of the marginal time-(t-1) smoothing distribution with zeros.
-        CSAux(arma::span(K, V+K-1), arma::span(K, V+K-1)) = CS.slice(t-1);
-            
-        Gk = CU.slice(t-1) * A.t() * arma::inv(CP.slice(t)); 
-        P2 = CU.slice(t-1) - Gk * CP.slice(t-1) * Gk.t(); 
-          
-        // The covariance matrix of the vector (x_t, x_{t-1}):
-        sigAux(arma::span(0, V-1), arma::span(0, V-1))   = CS.slice(t); 
-        sigAux(arma::span(V,2*V-1), arma::span(V,2*V-1)) = Gk.t() * CS.slice(t) * Gk.t() + P2; 
-        sigAux(arma::span(V,2*V-1), arma::span(0, V-1))  = CS.slice(t) * Gk.t();
-        sigAux(arma::span(0, V-1), arma::span(V,2*V-1))  = Gk.t() * CS.slice(t);
-        
-        sigAuxExt(arma::span(K,2*V+K-1), arma::span(K,2*V+K-1)) = sigAux; // padded by zeros
-      
-        // Smoothed mean padded by zeros
-        mExt(arma::span(K,K+V-1)) = mS.col(t-1);
-        
+        cholCP = arma::chol(CP.slice(t));
+        GkT = arma::solve(arma::trimatu(cholCP), arma::solve(arma::trimatl(cholCP.t()), A * CU.slice(t-1)));
+        crossCov = CS.slice(t) * GkT;
       }
-          
+      
+      #pragma omp parallel for num_threads(std::max(nCores, 1u)) schedule(static) if(nCores > 1)
       for (unsigned int v=0; v<V; v++) 
       { 
         if (t > 0)
         {
-          for (unsigned int k=0; k<K+1; k++) 
-          { 
-            QAux(k) = sigAuxExt(K+v, K+V+v-k) + mExt(K+v-k) * mS(v,t);
-            if (k > 0) 
-            {
-              QAux(k) += sigAuxExt(K+v, K+V+v+k) + mExt(K+v+k) * mS(v,t);
-            }
-              
-            for (unsigned int l=0; l<K+1; l++) 
-            { 
-              HAux(k,l) = CSAux(K+v-k,K+v-l) + mExt(K+v-k) * mExt(K+v-l);
-              if (k > 0 && l > 0)
-              {
-                HAux(k,l) += CSAux(K+v+k,K+v-l) + mExt(K+v+k) * mExt(K+v-l) +
-                            CSAux(K+v+k,K+v+l) + mExt(K+v+k) * mExt(K+v+l) +
-                            CSAux(K+v-k,K+v+l) + mExt(K+v-k) * mExt(K+v+l);
-              }
-              else if (k > 0 && l==0)
-              {
-                HAux(k,l) += CSAux(K+v+k,K+v-l) + mExt(K+v+k) * mExt(K+v-l);
-              }
-              else if (l > 0 && k==0)
-              {
-                HAux(k,l) += CSAux(K+v-k,K+v+l) + mExt(K+v-k) * mExt(K+v+l);
-              }
-                
-            }
-          }    
+          // Band of components of x_{t-1} which interact with the vth component of x_t:
+          const unsigned int lb = (v > K) ? v - K : 0;
+          const unsigned int ub = std::min(v + K, V - 1);
+          
+          // Maps the band to the K+1 additive functionals x_{t-1}(v) and 
+          // x_{t-1}(v-k) + x_{t-1}(v+k), k = 1, ..., K (padded by zeros):
+          arma::mat P(ub - lb + 1, K+1, arma::fill::zeros);
+          P(v - lb, 0) = 1.0;
+          for (unsigned int k=1; k<K+1; k++) 
+          {
+            if (v >= lb + k) {P(v - k - lb, k) = 1.0;}
+            if (v + k <= ub) {P(v + k - lb, k) = 1.0;}
+          }
+          
+          const arma::colvec mBand = mS(arma::span(lb, ub), arma::span(t-1, t-1));
+          
+          suffS1Comp.slice(v) += P.t() * (CS.slice(t-1)(arma::span(lb, ub), arma::span(lb, ub)) + mBand * mBand.t()) * P;
+          suffS2Comp.col(v)   += P.t() * (arma::trans(crossCov(arma::span(v, v), arma::span(lb, ub))) + mS(v,t) * mBand);
         }
           
-        RAux = CS(v,v,t) + pow(mS(v,t), 2.0);
-        SAux = mS(v,t) * y(v,t);
+        double RAux = CS(v,v,t) + mS(v,t) * mS(v,t);
         
         if (t == 0)
         {
@@ -185,11 +159,8 @@ namespace highDim
         }
               
         // Storing the spatial component-wise sufficient statistics
-        suffS1Comp.slice(v) += HAux;
-        suffS2Comp.col(v)   += QAux;
-        suffS3Comp(v)       += RAux;
-        suffS4Comp(v)       += SAux;
-        
+        suffS3Comp(v) += RAux;
+        suffS4Comp(v) += mS(v,t) * y(v,t);
       }
     }
   }
@@ -348,8 +319,8 @@ namespace highDim
     arma::mat mP, mU, mS;
     arma::cube CP, CU, CS;
     
-    computeModelParameters(A, B, C, D, V, V, K, theta, param); 
-    kalman::runSmoother(mP, CP, mU, CU, mS, CS, A, B, C, D, m0, C0, y);
+    computeModelParameters(A, B, C, D, K, V, V, theta, param); 
+    kalman::runForwardFilteringBackwardSmoothing(mP, CP, mU, CU, mS, CS, A, B, C, D, m0, C0, y);
 
     // Component-wise sufficient statistics:
     arma::cube suffS1Comp(K+1,K+1, V, arma::fill::zeros);
@@ -65,7 +65,9 @@ namespace kalman
     
   }
   /// Runs a Kalman filter and returns the log-marginal likelihood
-  /// (overload for univariate case).
+  /// (overload for univariate case). Once the variance recursion has 
+  /// converged (up to the relative tolerance tolSteadyState), only the 
+  /// means are updated.
   double evaluateLogMarginalLikelihood(
     const double A, 
     const double B, 
@@ -73,7 +75,8 @@ namespace kalman
     const double D, 
     const double m0, 
     const double C0, 
-    const arma::colvec& y
+    const arma::colvec& y,
+    const double tolSteadyState = 1e-10
   )
   {
     unsigned int T = y.size();
@@ -94,6 +97,9 @@ namespace kalman
     double Q = B * B;
     double R = D * D;
     double kg;
+    double CPOld = 0;
+    double logCY = 0;
+    bool isSteadyState = false;
     
     for (unsigned int t=0; t<T; t++)
     {
@@ -101,7 +107,10 @@ namespace kalman
       if (t > 0) 
       {
         mP = A * mU;
-        CP = A * CU * A + Q; 
+        if (!isSteadyState)
+        {
+          CP = A * CU * A + Q; 
+        }
       } 
       else 
       {
@@ -111,20 +120,31 @@ namespace kalman
       
       // Likelihood step
       mY = C * mP;
-      CY = C * CP * C + R;
+      if (!isSteadyState)
+      {
+        CY = C * CP * C + R;
+        logCY = std::log(CY);
+        kg = C * CP / CY;
+        CU = CP - kg * C * CP;
+        isSteadyState = t > 0 && std::abs(CP - CPOld) <= tolSteadyState * std::abs(CP);
+        CPOld = CP;
+      }
 
       // Update step
-      kg = C * CP / CY;
       mU = mP + kg * (y(t) - mY);
-      CU = CP - kg * C * CP;
 
       // Adding the incremental log-marginal likelihood
-      logLikelihood += gaussian::evaluateDensityUnivariate(y(t), mY, CY, false, true);
+      logLikelihood += - 0.5 * (log2pi + logCY + (y(t) - mY) * (y(t) - mY) / CY);
     }
     return logLikelihood;
   }
   /// Runs a Kalman filter and returns the log-marginal likelihood
-  /// (overload for multivariate case).
+  /// (overload for multivariate case). The Cholesky factor of the 
+  /// covariance matrix of the incremental likelihood is used both for 
+  /// the Kalman gain and for the density. Once the Riccati recursion has 
+  /// converged (up to the relative tolerance tolSteadyState), the gain 
+  /// and the Cholesky factor are kept fixed so that each remaining step 
+  /// only requires matrix-vector products and one triangular solve.
   double evaluateLogMarginalLikelihood(
     const arma::mat& A, 
     const arma::mat& B, 
@@ -132,7 +152,8 @@ namespace kalman
     const arma::mat& D, 
     const arma::mat& m0, 
     const arma::mat& C0, 
-    const arma::mat& y
+    const arma::mat& y,
+    const double tolSteadyState = 1e-10
   )
   {
     unsigned int dimX = A.n_rows;
@@ -158,6 +179,11 @@ namespace kalman
     arma::mat Q = B * B.t();
     arma::mat R = D * D.t();
     arma::mat kg;
+    arma::mat CPOld;
+    arma::mat cholCY; // upper-triangular Cholesky factor of CY
+    arma::colvec z(dimY); // "whitened" innovations
+    double logDetCY = 0;
+    bool isSteadyState = false;
     
     for (unsigned int t=0; t<T; t++)
     {
@@ -165,7 +191,10 @@ namespace kalman
       if (t > 0) 
       {
         mP = A * mU;
-        CP = A * CU * A.t() + Q; 
+        if (!isSteadyState)
+        {
+          CP = A * CU * A.t() + Q; 
+        }
       } 
       else 
       {
@@ -175,15 +204,206 @@ namespace kalman
       
       // Likelihood step
       mY = C * mP;
-      CY = C * CP * C.t() + R;
+      if (!isSteadyState)
+      {
+        CY = C * CP * C.t() + R;
+        cholCY = arma::chol(CY);
+        logDetCY = 2.0 * arma::accu(arma::log(cholCY.diag()));
+        kg = arma::trans(arma::solve(arma::trimatu(cholCY), arma::solve(arma::trimatl(cholCY.t()), C * CP)));
+        CU = CP - kg * C * CP;
+        isSteadyState = t > 0 && arma::abs(CP - CPOld).max() <= tolSteadyState * arma::abs(CP).max();
+        CPOld = CP;
+      }
 
       // Update step
-      kg = (arma::solve(CY.t(), C * CP.t())).t();
       mU = mP + kg * (y.col(t) - mY);
-      CU = CP - kg * C * CP;
 
       // Adding the incremental log-marginal likelihood
-      logLikelihood += arma::as_scalar(gaussian::evaluateDensityMultivariate(y.col(t), mY, CY, false, true));
+      z = arma::solve(arma::trimatl(cholCY.t()), y.col(t) - mY);
+      logLikelihood += - 0.5 * (dimY * log2pi + logDetCY + arma::dot(z, z));
+    }
+    return logLikelihood;
+  }
+  /// Runs Kalman filters for M sets of parameters in lockstep and returns 
+  /// the M log-marginal likelihoods (overload for univariate case). The 
+  /// mth element of A, B, C, D, m0, C0 holds the mth parameter set. The 
+  /// parameter sets are split into nCores contiguous chunks which are 
+  /// processed in parallel. As in evaluateLogMarginalLikelihood(), the
+  /// variance recursion of each filter is frozen once it has converged.
+  arma::colvec evaluateLogMarginalLikelihoodBatch(
+    const arma::colvec& A, 
+    const arma::colvec& B, 
+    const arma::colvec& C, 
+    const arma::colvec& D, 
+    const arma::colvec& m0, 
+    const arma::colvec& C0, 
+    const arma::colvec& y,
+    const unsigned int nCores = 1,
+    const double tolSteadyState = 1e-10
+  )
+  {
+    unsigned int T = y.size();
+    unsigned int M = A.size();
+    unsigned int nChunks = std::max(std::min(nCores, M), 1u);
+    
+    // Updated means and variances
+    arma::colvec mU(M), CU(M);
+    
+    // Predictive variances, variances of the incremental likelihood and Kalman gains
+    arma::colvec CP(M), CPOld(M), CY(M), logCY(M), kg(M);
+    arma::uvec isSteadyState(M, arma::fill::zeros);
+    
+    // Log-marginal likelihoods
+    arma::colvec logLikelihood(M, arma::fill::zeros);
+    
+    // Auxiliary quantities
+    arma::colvec Q = B % B;
+    arma::colvec R = D % D;
+    
+    #pragma omp parallel for num_threads(nChunks) schedule(static) if(nChunks > 1)
+    for (unsigned int c=0; c<nChunks; c++)
+    {
+      const unsigned int lb = (c * M) / nChunks;
+      const unsigned int ub = ((c + 1) * M) / nChunks;
+      double mP, mY;
+      
+      for (unsigned int t=0; t<T; t++)
+      {
+        for (unsigned int m=lb; m<ub; m++)
+        {
+          // Prediction step
+          if (t > 0) 
+          {
+            mP = A(m) * mU(m);
+            if (!isSteadyState(m))
+            {
+              CP(m) = A(m) * CU(m) * A(m) + Q(m); 
+            }
+          } 
+          else 
+          {
+            mP    = m0(m);
+            CP(m) = C0(m); 
+          }
+          
+          // Likelihood step
+          mY = C(m) * mP;
+          if (!isSteadyState(m))
+          {
+            CY(m)    = C(m) * CP(m) * C(m) + R(m);
+            logCY(m) = std::log(CY(m));
+            kg(m)    = C(m) * CP(m) / CY(m);
+            CU(m)    = CP(m) - kg(m) * C(m) * CP(m);
+            isSteadyState(m) = t > 0 && std::abs(CP(m) - CPOld(m)) <= tolSteadyState * std::abs(CP(m));
+            CPOld(m) = CP(m);
+          }
+
+          // Update step
+          mU(m) = mP + kg(m) * (y(t) - mY);
+
+          // Adding the incremental log-marginal likelihood
+          logLikelihood(m) += - 0.5 * (log2pi + logCY(m) + (y(t) - mY) * (y(t) - mY) / CY(m));
+        }
+      }
+    }
+    return logLikelihood;
+  }
+  /// Runs Kalman filters for M sets of parameters in lockstep and returns 
+  /// the M log-marginal likelihoods (overload for multivariate case). The 
+  /// mth slice of A, B, C, D, C0 and the mth column of m0 hold the mth 
+  /// parameter set. The filter states of all parameter sets are stored 
+  /// contiguously (the mth column/slice belongs to the mth filter) and the 
+  /// parameter sets are split into nCores contiguous chunks which are 
+  /// processed in parallel. As in evaluateLogMarginalLikelihood(), the gain 
+  /// and Cholesky factor of each filter are frozen once its Riccati 
+  /// recursion has converged.
+  arma::colvec evaluateLogMarginalLikelihoodBatch(
+    const arma::cube& A, 
+    const arma::cube& B, 
+    const arma::cube& C, 
+    const arma::cube& D, 
+    const arma::mat& m0, 
+    const arma::cube& C0, 
+    const arma::mat& y,
+    const unsigned int nCores = 1,
+    const double tolSteadyState = 1e-10
+  )
+  {
+    unsigned int dimX = A.n_rows;
+    unsigned int dimY = y.n_rows;
+    unsigned int T    = y.n_cols;
+    unsigned int M    = A.n_slices;
+    unsigned int nChunks = std::max(std::min(nCores, M), 1u);
+    
+    // Updated means and covariance matrices
+    arma::mat  mU(dimX, M);
+    arma::cube CU(dimX, dimX, M);
+    
+    // Predictive covariance matrices, Kalman gains and upper-triangular 
+    // Cholesky factors of the covariance matrices of the incremental likelihood
+    arma::cube CP(dimX, dimX, M), CPOld(dimX, dimX, M);
+    arma::cube kg(dimX, dimY, M);
+    arma::cube cholCY(dimY, dimY, M);
+    arma::colvec logDetCY(M);
+    arma::uvec isSteadyState(M, arma::fill::zeros);
+    
+    // Log-marginal likelihoods
+    arma::colvec logLikelihood(M, arma::fill::zeros);
+    
+    // Auxiliary quantities
+    arma::cube Q(dimX, dimX, M), R(dimY, dimY, M);
+    for (unsigned int m=0; m<M; m++)
+    {
+      Q.slice(m) = B.slice(m) * B.slice(m).t();
+      R.slice(m) = D.slice(m) * D.slice(m).t();
+    }
+    
+    #pragma omp parallel for num_threads(nChunks) schedule(static) if(nChunks > 1)
+    for (unsigned int c=0; c<nChunks; c++)
+    {
+      const unsigned int lb = (c * M) / nChunks;
+      const unsigned int ub = ((c + 1) * M) / nChunks;
+      arma::colvec mP(dimX), mY(dimY), z(dimY);
+      
+      for (unsigned int t=0; t<T; t++)
+      {
+        for (unsigned int m=lb; m<ub; m++)
+        {
+          // Prediction step
+          if (t > 0) 
+          {
+            mP = A.slice(m) * mU.col(m);
+            if (!isSteadyState(m))
+            {
+              CP.slice(m) = A.slice(m) * CU.slice(m) * A.slice(m).t() + Q.slice(m); 
+            }
+          } 
+          else 
+          {
+            mP          = m0.col(m);
+            CP.slice(m) = C0.slice(m); 
+          }
+          
+          // Likelihood step
+          mY = C.slice(m) * mP;
+          if (!isSteadyState(m))
+          {
+            cholCY.slice(m) = arma::chol(C.slice(m) * CP.slice(m) * C.slice(m).t() + R.slice(m));
+            logDetCY(m) = 2.0 * arma::accu(arma::log(cholCY.slice(m).diag()));
+            kg.slice(m) = arma::trans(arma::solve(arma::trimatu(cholCY.slice(m)), arma::solve(arma::trimatl(cholCY.slice(m).t()), C.slice(m) * CP.slice(m))));
+            CU.slice(m) = CP.slice(m) - kg.slice(m) * C.slice(m) * CP.slice(m);
+            isSteadyState(m) = t > 0 && arma::abs(CP.slice(m) - CPOld.slice(m)).max() <= tolSteadyState * arma::abs(CP.slice(m)).max();
+            CPOld.slice(m) = CP.slice(m);
+          }
+
+          // Update step
+          mU.col(m) = mP + kg.slice(m) * (y.col(t) - mY);
+
+          // Adding the incremental log-marginal likelihood
+          z = arma::solve(arma::trimatl(cholCY.slice(m).t()), y.col(t) - mY);
+          logLikelihood(m) += - 0.5 * (dimY * log2pi + logDetCY(m) + arma::dot(z, z));
+        }
+      }
     }
     return logLikelihood;
   }
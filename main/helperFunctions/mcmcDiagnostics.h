@@ -0,0 +1,111 @@
+/// \file
+/// \brief Some helper functions for assessing the convergence of MCMC chains.
+///
+/// This file contains the functions for computing the potential scale
+/// reduction factor (R-hat) and the effective sample size from several
+/// MCMC chains as in Gelman et al. (2013, Bayesian Data Analysis, Ch. 11).
+/// Each chain is stored as a (d, n)-matrix whose columns are the
+/// (d-dimensional) states at the n iterations.
+
+#ifndef __MCMCDIAGNOSTICS_H
+#define __MCMCDIAGNOSTICS_H
+
+#define ARMA_NO_DEBUG
+#include <RcppArmadillo.h>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace mcmcDiagnostics
+{
+  /// Returns the within-chain variance W and the (marginal posterior) variance
+  /// estimate varPlus = (n-1)/n W + B/n for each of the d components, where
+  /// B/n is the variance of the chain means.
+  void computeVariances(arma::colvec& W, arma::colvec& varPlus, const std::vector<arma::mat>& chains)
+  {
+    const unsigned int m = chains.size();
+    const unsigned int d = chains[0].n_rows;
+    const unsigned int n = chains[0].n_cols;
+
+    arma::mat means(d, m);
+    W.zeros(d);
+    for (unsigned int j=0; j<m; j++)
+    {
+      means.col(j) = arma::mean(chains[j], 1);
+      W += arma::var(chains[j], 0, 1);
+    }
+    W /= m;
+
+    arma::colvec BOverN(d, arma::fill::zeros);
+    if (m > 1)
+    {
+      BOverN = arma::var(means, 0, 1);
+    }
+    varPlus = (n - 1.0) / n * W + BOverN;
+  }
+  /// Returns the potential scale reduction factor for each component.
+  /// Components which are constant across all chains are assigned R-hat 1.
+  arma::colvec computeRhat(const std::vector<arma::mat>& chains)
+  {
+    arma::colvec W, varPlus;
+    computeVariances(W, varPlus, chains);
+    arma::colvec rHat = arma::sqrt(varPlus / W);
+    rHat.elem(arma::find(varPlus <= 0)).ones();
+    return rHat;
+  }
+  /// Returns the effective sample size (pooled over all chains) for each
+  /// component. The autocorrelations are estimated via variograms and
+  /// summed up to the last lag at which the sum of two consecutive
+  /// autocorrelations is still positive (Geyer, 1992). Components which 
+  /// are constant across all chains carry no Monte Carlo error and are 
+  /// assigned an infinite ESS so that they never limit the minimum ESS.
+  arma::colvec computeEss(const std::vector<arma::mat>& chains)
+  {
+    const unsigned int m = chains.size();
+    const unsigned int d = chains[0].n_rows;
+    const unsigned int n = chains[0].n_cols;
+
+    arma::colvec W, varPlus;
+    computeVariances(W, varPlus, chains);
+
+    arma::colvec ess(d);
+    double variogram, rhoEven, rhoOdd, sumRho;
+
+    for (unsigned int i=0; i<d; i++)
+    {
+      if (!(varPlus(i) > 0))
+      {
+        ess(i) = std::numeric_limits<double>::infinity();
+        continue;
+      }
+
+      sumRho = 0.0;
+      for (unsigned int t=1; t+1<n; t+=2)
+      {
+        // Autocorrelations at lags t and t+1:
+        variogram = 0.0;
+        for (unsigned int j=0; j<m; j++)
+        {
+          variogram += arma::accu(arma::square(chains[j].row(i).cols(t, n-1) - chains[j].row(i).cols(0, n-1-t)));
+        }
+        rhoOdd = 1.0 - variogram / (m * (n - t)) / (2.0 * varPlus(i));
+
+        variogram = 0.0;
+        for (unsigned int j=0; j<m; j++)
+        {
+          variogram += arma::accu(arma::square(chains[j].row(i).cols(t+1, n-1) - chains[j].row(i).cols(0, n-2-t)));
+        }
+        rhoEven = 1.0 - variogram / (m * (n - t - 1)) / (2.0 * varPlus(i));
+
+        if (rhoOdd + rhoEven < 0)
+        {
+          break;
+        }
+        sumRho += rhoOdd + rhoEven;
+      }
+      ess(i) = m * n / (1.0 + 2.0 * sumRho);
+    }
+    return ess;
+  }
+}
+#endif
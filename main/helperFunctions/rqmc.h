@@ -0,0 +1,142 @@
+/// \file
+/// \brief Some helper functions for randomised quasi-Monte Carlo (RQMC).
+///
+/// This file contains the functions for generating randomised
+/// low-discrepancy point sets on the unit hypercube. Each point is
+/// marginally uniformly distributed so that the point sets can replace
+/// IID uniforms in samplers based on inverse CDFs without introducing bias.
+
+#ifndef __RQMC_H
+#define __RQMC_H
+
+#define ARMA_NO_DEBUG
+#include <RcppArmadillo.h>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+/// Type of randomised quasi-Monte Carlo point set.
+enum RqmcType
+{
+  RQMC_NONE = 0,          // IID uniforms
+  RQMC_SHIFTED_LATTICE,   // randomly shifted rank-1 (Korobov) lattice
+  RQMC_SCRAMBLED_HALTON   // Halton sequence with random digit permutations
+};
+
+namespace rqmc
+{
+  /// Returns the first d prime numbers.
+  arma::uvec computePrimes(const unsigned int d)
+  {
+    arma::uvec primes(d);
+    unsigned int nPrimes = 0;
+    unsigned int candidate = 2;
+    bool isPrime;
+
+    while (nPrimes < d)
+    {
+      isPrime = true;
+      for (unsigned int i=0; i<nPrimes && primes(i) * primes(i) <= candidate; i++)
+      {
+        if (candidate % primes(i) == 0)
+        {
+          isPrime = false;
+          break;
+        }
+      }
+      if (isPrime)
+      {
+        primes(nPrimes) = candidate;
+        nPrimes++;
+      }
+      candidate++;
+    }
+    return primes;
+  }
+  /// Returns a randomly shifted rank-1 lattice with n points in d
+  /// dimensions (as the columns of a (d, n)-matrix). The generating
+  /// vector is of Korobov type, (1, a, a^2, ...) mod n, with a close to
+  /// n/phi (phi being the golden ratio) which yields the Fibonacci
+  /// lattice in two dimensions. In one dimension, the points are
+  /// the stratified uniforms (k + U)/n as in systematic resampling.
+  arma::mat sampleShiftedLattice(const unsigned int n, const unsigned int d)
+  {
+    arma::colvec generator(d);
+    unsigned long int a = std::max(static_cast<unsigned long int>(std::floor(n / 1.6180339887498949 + 0.5)), 1ul);
+    unsigned long int g = 1;
+    for (unsigned int i=0; i<d; i++)
+    {
+      generator(i) = static_cast<double>(g);
+      g = (g * a) % n;
+    }
+
+    arma::colvec shift = arma::randu(d);
+    arma::mat u(d, n);
+    for (unsigned int k=0; k<n; k++)
+    {
+      u.col(k) = k * generator / n + shift;
+    }
+    return u - arma::floor(u);
+  }
+  /// Returns n points of the Halton sequence in d dimensions (as the
+  /// columns of a (d, n)-matrix) in which the digits in each base are
+  /// scrambled by independent random permutations, one for each digit
+  /// position (including the infinite tail of zero digits). Each point is
+  /// thus marginally uniform while the stratification of the Halton
+  /// sequence is preserved. The first point is skipped.
+  arma::mat sampleScrambledHalton(const unsigned int n, const unsigned int d)
+  {
+    arma::uvec primes = computePrimes(d);
+    arma::mat u(d, n, arma::fill::zeros);
+
+    for (unsigned int i=0; i<d; i++)
+    {
+      const unsigned int b = primes(i);
+
+      // Number of digits needed to reach double precision; the 
+      // remaining digits are accounted for by a uniform remainder below:
+      const unsigned int nDigits = static_cast<unsigned int>(std::ceil(53.0 * std::log(2.0) / std::log(static_cast<double>(b))));
+
+      // Random permutations of the digits {0, ..., b-1}, one per position:
+      arma::umat permutations(b, nDigits);
+      for (unsigned int k=0; k<nDigits; k++)
+      {
+        permutations.col(k) = arma::sort_index(arma::randu(b));
+      }
+
+      for (unsigned int k=0; k<n; k++)
+      {
+        unsigned long int index = k + 1;
+        double scale = 1.0 / b;
+        double x = 0.0;
+
+        for (unsigned int l=0; l<nDigits; l++)
+        {
+          x += permutations(index % b, l) * scale;
+          index /= b;
+          scale /= b;
+        }
+        // The permuted digits beyond position nDigits are IID uniform:
+        x += arma::randu() * scale * b;
+        u(i,k) = std::min(x, 1.0 - std::numeric_limits<double>::epsilon());
+      }
+    }
+    return u;
+  }
+  /// Returns n uniformly distributed points in d dimensions (as the
+  /// columns of a (d, n)-matrix) from the specified (randomised
+  /// quasi-Monte Carlo) point set.
+  arma::mat sample(const unsigned int n, const unsigned int d, const RqmcType type)
+  {
+    switch (type)
+    {
+      case RQMC_SHIFTED_LATTICE:
+        return sampleShiftedLattice(n, d);
+      case RQMC_SCRAMBLED_HALTON:
+        return sampleScrambledHalton(n, d);
+      default:
+        return arma::randu(d, n);
+    }
+  }
+}
+#endif
@@ -246,6 +246,25 @@ public:
   double evaluateLogLatentPriorDensity(const unsigned int t, const LatentVariable& latentVariable);
   /// Evaluates the log-observation density of the observations at Time t.
   double evaluateLogObservationDensity(const unsigned int t, const LatentVariable& latentVariable);
+  /// Samples a whole population of latent variables at Time 0 and stores
+  /// them in latentVariablesNew (whose size determines the number of samples).
+  void sampleFromInitialDistribution(std::vector<LatentVariable>& latentVariablesNew);
+  /// Samples a whole population of latent variables at Time t>0 from their
+  /// conditional prior and stores them in latentVariablesNew.
+  void sampleFromTransitionEquation(const unsigned int t, std::vector<LatentVariable>& latentVariablesNew, const std::vector<LatentVariable>& latentVariablesOld);
+  /// Evaluates the log-initial density of a whole population of latent
+  /// variables and stores the values in logDensities.
+  void evaluateLogInitialDensity(const std::vector<LatentVariable>& latentVariables, arma::colvec& logDensities);
+  /// Evaluates the log-transition density of a whole population of latent
+  /// variables at Time t>0 and stores the values in logDensities.
+  void evaluateLogTransitionDensity(const unsigned int t, const std::vector<LatentVariable>& latentVariablesNew, const std::vector<LatentVariable>& latentVariablesOld, arma::colvec& logDensities);
+  /// Evaluates the log-transition density of a single latent variable at 
+  /// Time t>0 given each of a whole population of latent variables at 
+  /// Time t-1 (e.g. for backward sampling) and stores the values in logDensities.
+  void evaluateLogTransitionDensity(const unsigned int t, const LatentVariable& latentVariableNew, const std::vector<LatentVariable>& latentVariablesOld, arma::colvec& logDensities);
+  /// Evaluates the log-observation density of the observations at Time t for
+  /// a whole population of latent variables and stores the values in logDensities.
+  void evaluateLogObservationDensity(const unsigned int t, const std::vector<LatentVariable>& latentVariables, arma::colvec& logDensities);
   /// Increases the gradient by the gradient of the log-prior density.
   void addGradLogPriorDensity(arma::colvec& gradient);
   /// Increases the gradient by the gradient of the log-initial density of
@@ -311,6 +330,77 @@ private:
   
 };
 
+///////////////////////////////////////////////////////////////////////////////
+/// Default implementations of the batch versions of the model functions.
+///////////////////////////////////////////////////////////////////////////////
+// These simply loop over the single-variable functions defined by each 
+// application. Models whose densities can be vectorised across particles
+// can override them through an explicit specialisation, e.g.
+// template <> void Model<ModelParameters, LatentVariable, LatentPath, 
+//   LatentPathRepar, Observations>::evaluateLogObservationDensity(...) {...}
+// which must appear before the first use of the Model class (see 
+// main/applications/linear/linear.h for an example).
+
+/// Samples a whole population of latent variables at Time 0.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::sampleFromInitialDistribution(std::vector<LatentVariable>& latentVariablesNew)
+{
+  for (unsigned int n=0; n<latentVariablesNew.size(); n++)
+  {
+    latentVariablesNew[n] = sampleFromInitialDistribution();
+  }
+}
+/// Samples a whole population of latent variables at Time t>0.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::sampleFromTransitionEquation(const unsigned int t, std::vector<LatentVariable>& latentVariablesNew, const std::vector<LatentVariable>& latentVariablesOld)
+{
+  latentVariablesNew.resize(latentVariablesOld.size());
+  for (unsigned int n=0; n<latentVariablesOld.size(); n++)
+  {
+    latentVariablesNew[n] = sampleFromTransitionEquation(t, latentVariablesOld[n]);
+  }
+}
+/// Evaluates the log-initial density of a whole population of latent variables.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::evaluateLogInitialDensity(const std::vector<LatentVariable>& latentVariables, arma::colvec& logDensities)
+{
+  logDensities.set_size(latentVariables.size());
+  for (unsigned int n=0; n<latentVariables.size(); n++)
+  {
+    logDensities(n) = evaluateLogInitialDensity(latentVariables[n]);
+  }
+}
+/// Evaluates the log-transition density of a whole population of latent variables.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::evaluateLogTransitionDensity(const unsigned int t, const std::vector<LatentVariable>& latentVariablesNew, const std::vector<LatentVariable>& latentVariablesOld, arma::colvec& logDensities)
+{
+  logDensities.set_size(latentVariablesNew.size());
+  for (unsigned int n=0; n<latentVariablesNew.size(); n++)
+  {
+    logDensities(n) = evaluateLogTransitionDensity(t, latentVariablesNew[n], latentVariablesOld[n]);
+  }
+}
+/// Evaluates the log-transition density of a single latent variable given a whole population of latent variables.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::evaluateLogTransitionDensity(const unsigned int t, const LatentVariable& latentVariableNew, const std::vector<LatentVariable>& latentVariablesOld, arma::colvec& logDensities)
+{
+  logDensities.set_size(latentVariablesOld.size());
+  for (unsigned int n=0; n<latentVariablesOld.size(); n++)
+  {
+    logDensities(n) = evaluateLogTransitionDensity(t, latentVariableNew, latentVariablesOld[n]);
+  }
+}
+/// Evaluates the log-observation density for a whole population of latent variables.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations> 
+void Model<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations>::evaluateLogObservationDensity(const unsigned int t, const std::vector<LatentVariable>& latentVariables, arma::colvec& logDensities)
+{
+  logDensities.set_size(latentVariables.size());
+  for (unsigned int n=0; n<latentVariables.size(); n++)
+  {
+    logDensities(n) = evaluateLogObservationDensity(t, latentVariables[n]);
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// Some non-member functions for use with in R.
 ///////////////////////////////////////////////////////////////////////////////
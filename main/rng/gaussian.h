@@ -11,6 +11,7 @@
 #include <omp.h>
 #include <random>
 #include <vector>
+#include "main/rng/truncatedNormal.h"
 
 const double log2pi = std::log(2.0 * M_PI);
 
@@ -159,6 +160,112 @@ namespace gaussian
 
 
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // Multivariate normal distribution with fixed covariance matrix
+  ////////////////////////////////////////////////////////////////////////////////
+  
+  /// Returns the differences between the columns of x and mean 
+  /// (either of which may consist of a single column).
+  arma::mat subtractMean(const arma::mat& x, const arma::mat& mean)
+  {
+    if (x.n_cols == mean.n_cols)
+    {
+      return x - mean;
+    }
+    else if (mean.n_cols == 1)
+    {
+      return x.each_col() - mean.col(0);
+    }
+    else
+    {
+      arma::mat diff = - mean;
+      diff.each_col() += x.col(0);
+      return diff;
+    }
+  }
+  
+  /// A multivariate normal distribution with fixed covariance matrix. The 
+  /// Cholesky factor and the log-determinant of the covariance matrix are 
+  /// computed only once so that repeated density evaluations (e.g. within 
+  /// MCMC kernels or transition densities) and draws reuse them. 
+  class GaussianDensity
+  {
+  public:
+    
+    /// Initialises the class.
+    GaussianDensity() : dim_(0), logNormalisingConstant_(0) {}
+    /// Initialises the class with a covariance matrix (or its 
+    /// upper-triangular Cholesky factor if is_chol is true).
+    GaussianDensity(const arma::mat& sigma, bool is_chol = false)
+    {
+      setCovarianceMatrix(sigma, is_chol);
+    }
+    
+    /// Specifies the covariance matrix (or its upper-triangular Cholesky 
+    /// factor if is_chol is true).
+    void setCovarianceMatrix(const arma::mat& sigma, bool is_chol = false)
+    {
+      if (is_chol == false)
+      {
+        cholSigmaLower_ = arma::trans(arma::chol(sigma));
+      }
+      else
+      {
+        cholSigmaLower_ = arma::trans(arma::trimatu(sigma));
+      }
+      dim_ = cholSigmaLower_.n_rows;
+      logNormalisingConstant_ = - 0.5 * static_cast<double>(dim_) * log2pi - arma::accu(arma::log(cholSigmaLower_.diag()));
+    }
+    /// Returns the dimension.
+    unsigned int getDim() const {return dim_;}
+    /// Returns the lower-triangular Cholesky factor of the covariance matrix.
+    const arma::mat& getCholSigmaLower() const {return cholSigmaLower_;}
+    /// Returns the log-determinant of the covariance matrix.
+    double getLogDeterminant() const 
+    {
+      return - 2.0 * (logNormalisingConstant_ + 0.5 * static_cast<double>(dim_) * log2pi);
+    }
+    
+    /// Evaluates the (log-)density at each column of x for the mean vector(s) 
+    /// given by the columns of mean (either of which may consist of a 
+    /// single column). All points are whitened via a single triangular solve.
+    arma::colvec evaluate(const arma::mat& x, const arma::mat& mean, bool logd = false) const
+    {
+      arma::mat z = arma::solve(arma::trimatl(cholSigmaLower_), subtractMean(x, mean));
+      arma::colvec out = logNormalisingConstant_ - 0.5 * arma::trans(arma::sum(z % z, 0));
+      
+      if (logd == false) 
+      {
+        out = arma::exp(out);
+      }
+      return out;
+    }
+    /// Samples n values with mean vector(s) given by the columns of mean
+    /// (which may consist of a single column).
+    arma::mat sample(unsigned int n, const arma::mat& mean) const
+    {
+      arma::mat x = cholSigmaLower_ * arma::randn(dim_, n);
+      
+      if (mean.n_cols == 1)
+      {
+        x.each_col() += mean.col(0);
+      }
+      else
+      {
+        x += mean;
+      }
+      return x;
+    }
+    
+  private:
+    
+    unsigned int dim_; // dimension
+    arma::mat cholSigmaLower_; // lower-triangular Cholesky factor of the covariance matrix
+    double logNormalisingConstant_; // log of the normalising constant of the density
+    
+  };
+
+
   ////////////////////////////////////////////////////////////////////////////////
   // Density of a multivariate normal distribution
   ////////////////////////////////////////////////////////////////////////////////
@@ -172,40 +279,7 @@ namespace gaussian
     bool logd = false,
     unsigned int cores = 1) 
   { 
-    //omp_set_num_threads(cores);
-    
-    unsigned int nx = x.n_cols;
-    unsigned int nm = mean.n_cols;
-    unsigned int dx = x.n_rows;
-    unsigned int n  = std::max(nx,nm);
-    
-    arma::colvec out(n);
-    arma::mat rooti; // Inverse root of the covariance matrix
-      
-    if (is_chol == false) 
-    {
-      rooti = arma::trans(arma::inv(arma::trimatu(arma::chol(sigma))));
-    } 
-    else 
-    {
-      rooti = arma::trans(arma::inv(arma::trimatu(sigma)));
-    }
-    double rootisum = arma::sum(log(rooti.diag()));
-    double constants = -(static_cast<double>(dx)/2.0) * log2pi;
-    
-    //# pragma omp parallel for schedule(static)
-    for (unsigned int i=0; i<n; i++) 
-    {
-      arma::vec z = rooti * (x.col(std::min(i,nx-1)) - mean.col(std::min(i,nm-1)));    
-      out(i)      = constants - 0.5 * arma::sum(z%z) + rootisum;     
-    }  
-        
-    if (logd == false) 
-    {
-      out = arma::exp(out);
-    }
-      
-    return out;
+    return GaussianDensity(sigma, is_chol).evaluate(x, mean, logd);
   }
 
   // Multiple evaluations/multiple mean vectors/covariance matrix is scaled identity matrix
@@ -217,14 +291,7 @@ namespace gaussian
     bool logd = false,
     unsigned int cores = 1) 
   { 
-    //omp_set_num_threads(cores);
-    
-    unsigned int nx = x.n_cols;
-    unsigned int nm = mean.n_cols;
     unsigned int dx = x.n_rows;
-    unsigned int n  = std::max(nx,nm);
-    
-    arma::colvec out(n);
     double rooti; // Inverse root of the covariance matrix
       
     if (is_chol == false)
@@ -239,12 +306,7 @@ namespace gaussian
     double rootisum = static_cast<double>(dx)*log(rooti);
     double constants = -(static_cast<double>(dx)/2.0) * log2pi;
     
-    //# pragma omp parallel for schedule(static)
-    for (unsigned int i=0; i<n; i++)
-    {
-      arma::vec z = rooti * (x.col(std::min(i,nx-1)) - mean.col(std::min(i,nm-1)));      
-      out(i)      = constants - 0.5 * arma::sum(z%z) + rootisum;     
-    }  
+    arma::colvec out = constants + rootisum - 0.5 * rooti * rooti * arma::trans(arma::sum(arma::square(subtractMean(x, mean)), 0));
         
     if (logd == false) {
       out = arma::exp(out);
@@ -305,6 +367,25 @@ namespace gaussian
   // Generating (univariate) truncated normal random variables
   ////////////////////////////////////////////////////////////////////////////////
 
+  // Truncated normal random numbers obtained by inverting the distribution 
+  // function at the uniform u (which may be taken from a randomised 
+  // quasi-Monte Carlo point set)
+  double rtnormFromUniform(
+    const double u,
+    const double lower,
+    const double upper,
+    const double mean,
+    const double sigma,
+    bool is_sd = false)
+  {
+    double sd = sigma;
+    if (is_sd == false)
+    {
+      sd = sqrt(sigma);
+    }
+    return truncatedNormal::sampleFromUniform(u, lower, upper, mean, sd);
+  }
+  
   // Normal random numbers: general covariance matrix
   double rtnorm(
     const double lower,
@@ -313,22 +394,14 @@ namespace gaussian
     const double sigma,
     bool is_sd = false)
   {
-    double x;
-    
     if (is_sd == true)
     {
-      x = R::qnorm(arma::as_scalar(R::pnorm(lower, mean, sigma, true, false) + arma::randu(1) * 
-            (R::pnorm(upper, mean, sigma, true, false) - R::pnorm(lower, mean, sigma, true, false))),
-            mean, sigma, true, false);
+      return truncatedNormal::sample(lower, upper, mean, sigma);
     }
     else 
     {
-      x = R::qnorm(arma::as_scalar(R::pnorm(lower, mean, sqrt(sigma), true, false) + arma::randu(1) * 
-            (R::pnorm(upper, mean, sqrt(sigma), true, false) - R::pnorm(lower, mean, sqrt(sigma), true, false))),
-            mean, sqrt(sigma), true, false);
+      return truncatedNormal::sample(lower, upper, mean, sqrt(sigma));
     }
-    
-    return(x);
   }
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -348,13 +421,11 @@ namespace gaussian
     double logDensity;
     if (is_sd == true)
     {
-      logDensity = R::dnorm(x, mean, sigma, 1) - 
-                  log(R::pnorm(upper, mean, sigma, 1, 0) - R::pnorm(lower, mean, sigma, 1, 0));
+      logDensity = truncatedNormal::evaluateLogDensity(x, lower, upper, mean, sigma);
     }
     else 
     {
-      logDensity = R::dnorm(x, mean, sqrt(sigma), 1) - 
-                  log(R::pnorm(upper, mean, sqrt(sigma), 1, 0) - R::pnorm(lower, mean, sqrt(sigma), 1, 0));
+      logDensity = truncatedNormal::evaluateLogDensity(x, lower, upper, mean, sqrt(sigma));
     }
     
     if (logd == false)
@@ -0,0 +1,252 @@
+/// \file
+/// \brief Some helper functions for dealing with truncated normal distributions.
+///
+/// This file contains the functions for evaluating the density of and
+/// sampling from univariate truncated normal distributions. The samplers
+/// use accept--reject schemes (Robert, 1995) whose efficiency does not
+/// deteriorate in the tails, and the normalising constants are evaluated
+/// in log-space without calling into R. For use with (randomised 
+/// quasi-Monte Carlo) uniforms, the distribution function can also be 
+/// inverted natively. Not for export to R.
+
+#ifndef __TRUNCATEDNORMAL_H
+#define __TRUNCATEDNORMAL_H
+
+#include <RcppArmadillo.h>
+#include <cmath>
+#include <limits>
+
+namespace truncatedNormal
+{
+  const double logSqrt2Pi = 0.5 * std::log(2.0 * M_PI);
+  const double halfNormalThreshold = 0.25696; // below this lower bound, half-normal proposals beat exponential ones
+
+  /// Returns the log of the standard normal survival function,
+  /// i.e. log(1 - Phi(x)), using an asymptotic expansion in the far
+  /// right tail.
+  double evaluateLogSurvival(const double x)
+  {
+    if (x < 30.0)
+    {
+      return std::log(0.5 * std::erfc(x / std::sqrt(2.0)));
+    }
+    else
+    {
+      double z = 1.0 / (x * x);
+      return - 0.5 * x * x - std::log(x) - logSqrt2Pi + std::log1p(z * (-1.0 + z * (3.0 - 15.0 * z)));
+    }
+  }
+  /// Returns the log of the normalising constant Phi(upper) - Phi(lower)
+  /// of the standard normal distribution truncated to [lower, upper].
+  double evaluateLogNormalisingConstant(const double lower, const double upper)
+  {
+    if (lower >= upper)
+    {
+      return - std::numeric_limits<double>::infinity();
+    }
+    if (upper <= 0)
+    {
+      return evaluateLogNormalisingConstant(-upper, -lower);
+    }
+    if (lower >= 0) // both bounds in the right tail
+    {
+      double logSurvivalLower = evaluateLogSurvival(lower);
+      return logSurvivalLower + std::log1p(- std::exp(evaluateLogSurvival(upper) - logSurvivalLower));
+    }
+    // The interval contains zero:
+    return std::log1p(- std::exp(evaluateLogSurvival(upper)) - std::exp(evaluateLogSurvival(-lower)));
+  }
+  /// Returns the log-density at x of the standard normal distribution
+  /// truncated to [lower, upper].
+  double evaluateLogDensityStandard(const double x, const double lower, const double upper)
+  {
+    if (x < lower || x > upper)
+    {
+      return - std::numeric_limits<double>::infinity();
+    }
+    return - logSqrt2Pi - 0.5 * x * x - evaluateLogNormalisingConstant(lower, upper);
+  }
+  /// Returns the log-density at x of the normal distribution with mean
+  /// mean and standard deviation sd truncated to [lower, upper].
+  double evaluateLogDensity(const double x, const double lower, const double upper, const double mean, const double sd)
+  {
+    return evaluateLogDensityStandard((x - mean) / sd, (lower - mean) / sd, (upper - mean) / sd) - std::log(sd);
+  }
+
+  /// Samples from the standard normal distribution truncated to
+  /// [lower, upper] with lower >= 0. Depending on the bounds, this uses
+  /// uniform, half-normal or translated-exponential proposals.
+  double sampleStandardRightTail(const double lower, const double upper)
+  {
+    double x;
+
+    // Optimal rate of the translated-exponential proposal:
+    double lambda = 0.5 * (lower + std::sqrt(lower * lower + 4.0));
+
+    // The uniform proposal is more efficient than the exponential one
+    // if the interval is short:
+    double uniformThreshold = lower + 2.0 * std::sqrt(M_E) / (lower + std::sqrt(lower * lower + 4.0)) *
+      std::exp(0.25 * (lower * lower - lower * std::sqrt(lower * lower + 4.0)));
+
+    if (upper <= uniformThreshold)
+    {
+      do
+      {
+        x = lower + (upper - lower) * arma::randu();
+      }
+      while (std::log(arma::randu()) > 0.5 * (lower * lower - x * x));
+    }
+    else if (lower < halfNormalThreshold)
+    {
+      do
+      {
+        x = std::abs(arma::randn());
+      }
+      while (x < lower || x > upper);
+    }
+    else
+    {
+      do
+      {
+        x = lower - std::log(arma::randu()) / lambda;
+      }
+      while (x > upper || std::log(arma::randu()) > - 0.5 * (x - lambda) * (x - lambda));
+    }
+    return x;
+  }
+  /// Samples from the standard normal distribution truncated to [lower, upper].
+  double sampleStandard(const double lower, const double upper)
+  {
+    double x;
+
+    if (lower >= 0)
+    {
+      x = sampleStandardRightTail(lower, upper);
+    }
+    else if (upper <= 0)
+    {
+      x = - sampleStandardRightTail(-upper, -lower);
+    }
+    else if (upper - lower < std::sqrt(2.0 * M_PI)) // uniform proposal (the mode 0 lies in the interval)
+    {
+      do
+      {
+        x = lower + (upper - lower) * arma::randu();
+      }
+      while (std::log(arma::randu()) > - 0.5 * x * x);
+    }
+    else // normal proposal
+    {
+      do
+      {
+        x = arma::randn();
+      }
+      while (x < lower || x > upper);
+    }
+    return x;
+  }
+  /// Samples from the normal distribution with mean mean and standard
+  /// deviation sd truncated to [lower, upper].
+  double sample(const double lower, const double upper, const double mean, const double sd)
+  {
+    return mean + sd * sampleStandard((lower - mean) / sd, (upper - mean) / sd);
+  }
+  /// Samples n values from the normal distribution with mean mean and
+  /// standard deviation sd truncated to [lower, upper].
+  arma::colvec sample(const unsigned int n, const double lower, const double upper, const double mean = 0.0, const double sd = 1.0)
+  {
+    const double lowerStandard = (lower - mean) / sd;
+    const double upperStandard = (upper - mean) / sd;
+    arma::colvec x(n);
+    for (unsigned int i=0; i<n; i++)
+    {
+      x(i) = mean + sd * sampleStandard(lowerStandard, upperStandard);
+    }
+    return x;
+  }
+
+  /// Returns the inverse of the log of the standard normal survival 
+  /// function, i.e. the value x with log(1 - Phi(x)) = logP. This uses 
+  /// Newton's method which converges monotonically because the log-survival 
+  /// function is concave.
+  double evaluateInverseLogSurvival(const double logP)
+  {
+    if (logP >= 0)
+    {
+      return - std::numeric_limits<double>::infinity();
+    }
+    if (logP == - std::numeric_limits<double>::infinity())
+    {
+      return std::numeric_limits<double>::infinity();
+    }
+    if (logP > - M_LN2) // i.e. the solution is negative
+    {
+      return - evaluateInverseLogSurvival(std::log1p(- std::exp(logP)));
+    }
+    
+    // Starting value from the tail asymptotics (the solution is non-negative):
+    double x = 0.0;
+    if (logP < -2.0)
+    {
+      x = std::sqrt(- 2.0 * logP - std::log(- 2.0 * logP) - 2.0 * logSqrt2Pi);
+    }
+    
+    double logSurvival, dx;
+    for (unsigned int k=0; k<100; k++)
+    {
+      logSurvival = evaluateLogSurvival(x);
+      dx = (logSurvival - logP) * std::exp(logSurvival + logSqrt2Pi + 0.5 * x * x);
+      x += dx;
+      if (std::abs(dx) <= 1e-14 * std::max(1.0, std::abs(x)))
+      {
+        break;
+      }
+    }
+    return x;
+  }
+  /// Returns the quantile at u of the standard normal distribution truncated 
+  /// to [lower, upper], i.e. a sample from this distribution if u is uniform 
+  /// (e.g. taken from a randomised quasi-Monte Carlo point set). In the tails, 
+  /// the distribution function is inverted in log-space.
+  double sampleStandardFromUniform(const double u, const double lower, const double upper)
+  {
+    if (lower >= upper)
+    {
+      return lower;
+    }
+    if (upper <= 0)
+    {
+      return - sampleStandardFromUniform(1.0 - u, -upper, -lower);
+    }
+    
+    double x;
+    if (lower >= 0) // both bounds in the right tail
+    {
+      double logSurvivalLower = evaluateLogSurvival(lower);
+      double logSurvivalUpper = evaluateLogSurvival(upper);
+      x = evaluateInverseLogSurvival(logSurvivalLower + std::log1p(u * std::expm1(logSurvivalUpper - logSurvivalLower)));
+    }
+    else // the interval contains zero
+    {
+      double cdfLower = std::exp(evaluateLogSurvival(-lower));
+      double cdfUpper = - std::expm1(evaluateLogSurvival(upper));
+      double p = cdfLower + u * (cdfUpper - cdfLower);
+      if (p <= 0.5)
+      {
+        x = - evaluateInverseLogSurvival(std::log(p));
+      }
+      else
+      {
+        x = evaluateInverseLogSurvival(std::log1p(- p));
+      }
+    }
+    return std::min(std::max(x, lower), upper);
+  }
+  /// Returns the quantile at u of the normal distribution with mean mean and 
+  /// standard deviation sd truncated to [lower, upper].
+  double sampleFromUniform(const double u, const double lower, const double upper, const double mean, const double sd)
+  {
+    return mean + sd * sampleStandardFromUniform(u, (lower - mean) / sd, (upper - mean) / sd);
+  }
+}
+#endif
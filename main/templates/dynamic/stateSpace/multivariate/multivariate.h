@@ -27,8 +27,19 @@ typedef arma::mat LatentPathRepar;
 /// Holds all observations.
 typedef arma::mat Observations;
 
-/// Holds a single particle
+/// Holds a single particle. If MULTIVARIATE_DIM_PARTICLE is defined (as 
+/// the dimension of the latent variables) before this file is included, 
+/// the particles are fixed-size vectors which store their elements 
+/// internally, i.e. sampling, weighting and copying particles during 
+/// resampling does not require any heap allocations. In this case, the 
+/// model-specific code must not rely on the particles being arma::colvec's 
+/// (arma::vec::fixed<D> can, however, be passed wherever a 
+/// const arma::colvec& is expected).
+#ifdef MULTIVARIATE_DIM_PARTICLE
+typedef arma::vec::fixed<MULTIVARIATE_DIM_PARTICLE> Particle;
+#else
 typedef arma::colvec Particle;
+#endif
 
 /// Holds (some of the) Gaussian auxiliary variables generated as part of 
 /// the SMC algorithm.
@@ -497,10 +497,12 @@ Rcpp::List runOemCpp(
 // [[Rcpp::export]]
 Rcpp::List runOnlineStochasticGradientAscentCpp(
   const unsigned int N,    // number of particles
+  const unsigned int M,    // number of backward draws per particle (only used if back = 2, i.e. PaRIS)
   arma::mat& blockInn,
   arma::mat& blockOut,
   unsigned int padding,
   unsigned int filt,
+  unsigned int back,       // type of backward kernel to use
   unsigned int prop,       // use locally optimal proposal kernel?
   arma::colvec& thetaInit, 
   arma::colvec& stepSizes,
@@ -528,7 +530,8 @@ Rcpp::List runOnlineStochasticGradientAscentCpp(
   }
   
   S.setBlocks(blockInn, blockOut);
-  
+  S.set_back(static_cast<BackwardKernelType>(back));
+  S.setM(M);
     
   std::cout << "run online algorithm" << std::endl;
   S.runBlockedOnlineGradientAscent(thetaInit, updateAfterEachBlock, padding);
@@ -545,6 +548,7 @@ Rcpp::List runOnlineStochasticGradientAscentCpp(
 // [[Rcpp::export]]
 Rcpp::List runOnlineStochasticGradientAscentEnlargedCpp(
   const unsigned int N,    // number of particles
+  const unsigned int M,    // number of backward draws per particle (only used if back = 2, i.e. PaRIS)
   const bool normaliseByL2Norm, // should the gradient approximation be normalised by the L2 norm?
   const bool estimateTheta, // should theta be updated after each time step?
   arma::mat& blockInn,
@@ -569,6 +573,7 @@ Rcpp::List runOnlineStochasticGradientAscentEnlargedCpp(
   
   S.setBlocks(blockInn, blockOut);
   S.set_back(static_cast<BackwardKernelType>(back));
+  S.setM(M);
 
   
   arma::mat gradBlockOut;
@@ -71,6 +71,46 @@ H    <- 1 # effective sample size-based adaptive resampling threshold
 # because all particles miss important regions of the state space;
 
 
+## ========================================================================= ##
+## CHECK: BLOCKED PARTICLE FILTER VS. KALMAN FILTER
+## ========================================================================= ##
+
+# On a small model with independent components, the blocked particle filter 
+# with singleton blocks (and with a single block covering the whole state
+# space) is a collection of (one) standard bootstrap particle filter(s), 
+# so that its marginal-likelihood estimate must agree with the Kalman filter 
+# up to Monte Carlo error.
+
+VCheck  <- 4 # dimension of the state space
+TCheck  <- 25 # number of time steps
+NCheck  <- 2000 # number of particles
+RCheck  <- 50 # number of independent replicates
+
+ACheck  <- 0.5*diag(VCheck)
+BCheck  <- diag(VCheck)
+CCheck  <- diag(VCheck)
+DCheck  <- diag(VCheck)
+m0Check <- rep(0, VCheck)
+C0Check <- diag(VCheck)
+yCheck  <- simulateDataCpp(TCheck, ACheck, BCheck, CCheck, DCheck, m0Check, C0Check)$y
+
+logLikeCheckTrue <- kalmanCpp(ACheck, BCheck, CCheck, DCheck, m0Check, C0Check, yCheck)
+
+for (bInnCheck in c(1, VCheck)) {
+  aux <- setBlocks(bInnCheck, 0, VCheck)
+  logLikeCheckEst <- rep(NA, RCheck)
+  for (rr in 1:RCheck) {
+    logLikeCheckEst[rr] <- bpfCpp(NCheck, 0, aux$blockInn, aux$blockOut, ACheck, BCheck, CCheck, DCheck, m0Check, C0Check, yCheck, nCores)
+  }
+  errCheck <- mean(logLikeCheckEst) - logLikeCheckTrue
+  tolCheck <- 4*sd(logLikeCheckEst)/sqrt(RCheck) + var(logLikeCheckEst) # Monte Carlo error plus the (negative) bias of the log-estimate
+  print(paste("BPF with block size ", bInnCheck, ": mean log-likelihood estimate ", mean(logLikeCheckEst), "; Kalman filter: ", logLikeCheckTrue, sep=''))
+  if (abs(errCheck) > tolCheck) {
+    print("WARNING: blocked particle filter disagrees with the Kalman filter!")
+  }
+}
+
+
 ## ========================================================================= ##
 ## SIMULATION STUDY I: ESTIMATING SUFFICIENT STATISTICS & GRADIENTS
 ## AS A FUNCTION OF THE DIMENSION OF THE STATE SPACE
@@ -585,8 +625,8 @@ for (mm in 1:M1) {
   
   for (ll in 1:L1) {
     print(ll)
-#     thetaBlock[,,ll,mm] <- runOnlineStochasticGradientAscentCpp(N, blockInn, blockOut, padding, FILT[ll], prop, thetaInit, stepSizesBlock, m0, C0, y, nCores)$theta
-    thetaTime[,,ll,mm]  <- runOnlineStochasticGradientAscentEnlargedCpp(N, NORMALISE_BY_L2_NORM, ESTIMATE_THETA, blockInn, blockOut, FILT[ll], BACK[ll], prop, thetaInit, stepSizesTime, m0, C0, y, nCores)$theta
+#     thetaBlock[,,ll,mm] <- runOnlineStochasticGradientAscentCpp(N, M, blockInn, blockOut, padding, FILT[ll], BACK[ll], prop, thetaInit, stepSizesBlock, m0, C0, y, nCores)$theta
+    thetaTime[,,ll,mm]  <- runOnlineStochasticGradientAscentEnlargedCpp(N, M, NORMALISE_BY_L2_NORM, ESTIMATE_THETA, blockInn, blockOut, FILT[ll], BACK[ll], prop, thetaInit, stepSizesTime, m0, C0, y, nCores)$theta
 
   }
 
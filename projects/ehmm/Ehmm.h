@@ -57,6 +57,7 @@ public:
     nCores_(nCores)
   {
     samplePath_ = true; // TODO: make this accessible from the outside
+    nChains_ = 1;
     ehmmParameters_.setParameters(algorithmParameters); // determines additional parameters of the algorithm 
   }
   
@@ -70,6 +71,20 @@ public:
   arma::colvec getEss() const {return ess_;}
   /// Returns the acceptance rates for each time step.
   arma::colvec getAcceptanceRates() const {return acceptanceRates_;}
+  /// Returns the number of MCMC chains used for generating the pool of particles at each time step.
+  unsigned int getNChains() const {return nChains_;}
+  /// Specifies the number of MCMC chains used for generating the pool of 
+  /// particles at each time step. If nChains > 1, the pool is the union of 
+  /// nChains shorter chains (see runChains()).
+  /// This is not supported for the local moves based on the Hilbert sort.
+  void setNChains(const unsigned int nChains) 
+  {
+    nChains_ = std::max(nChains, 1u);
+    if (nChains_ > 1 && (local_ == EHMM_LOCAL_HILBERT_AUTOREGRESSIVE || local_ == EHMM_LOCAL_HILBERT_RANDOM_WALK))
+    {
+      std::cout << "WARNING: multiple chains are not supported with Hilbert-sort based local moves; using a single chain!" << std::endl;
+    }
+  }
   /// Converts a particle path into the set of all latent variables in the model.
   void convertParticlePathToLatentPath(const std::vector<Particle>& particlePath, LatentPath& latentPath);
   /// Converts the set of all latent variables in the model into a particle path.
@@ -169,6 +184,18 @@ private:
   void applyKernel(const unsigned int t, const unsigned int n, const unsigned int m, std::vector<Particle>& particles, arma::uvec& parentIndices, const arma::colvec& logUnnormalisedWeights, const arma::colvec& selfNormalisedWeights);
   /// Applies rho_0-invariant kernel
   void applyInitialKernel(const unsigned int n, const unsigned int m, std::vector<Particle>& particles);
+  /// Returns whether the pool at each time step is generated by multiple chains.
+  bool useMultipleChains() const
+  {
+    return nChains_ > 1 && local_ != EHMM_LOCAL_HILBERT_AUTOREGRESSIVE && local_ != EHMM_LOCAL_HILBERT_RANDOM_WALK;
+  }
+  /// Generates the pool of particles at time t as the union of nChains_ 
+  /// shorter rho_t-invariant MCMC chains which are run one after another. 
+  /// Each chain fills a contiguous block of particle indices. The chain 
+  /// whose block contains the conditioned index (if any) is run forwards 
+  /// and backwards from the conditioned particle; all other chains start 
+  /// from an independent draw from rho_t.
+  void runChains(const unsigned int t, std::vector<Particle>& particlesNew, arma::uvec& parentIndices, const arma::colvec& logUnnormalisedWeights);
 
   /// Calculates log-unnormalised particle weights at the first SMC Step.
   void computeLogInitialParticleWeights(const std::vector<Particle>& particles, arma::colvec& logUnnormalisedWeights);
@@ -223,6 +250,7 @@ private:
   unsigned int sortedParentIndex_, sortedParentIndexTemp_; // post sorted index of the particle of the distinguished path
   arma::colvec ess_; // effective sample size at each time step.
   arma::colvec acceptanceRates_; // acceptanceRates at each time step.
+  unsigned int nChains_; // number of MCMC chains used for generating the pool of particles at each time step
   unsigned int nCores_; // number of cores to use (not currently used)
   
 };
@@ -277,7 +305,7 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
     particlesNew[particleIndices_(0)] = particlePath_[0];
     
 //     std::cout << "applying initial kernel" << std::endl;
-    if (particleIndices_(0) > 0)
+    if (particleIndices_(0) > 0 && !useMultipleChains())
     {
       for (unsigned int n=particleIndices_(0)-1; n != static_cast<unsigned>(-1); n--)
       {
@@ -288,11 +316,21 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
   else
   {
     particleIndices_(0) = 0;
-    this->sampleFromInitialRho(0, particlesNew);
+    if (!useMultipleChains())
+    {
+      this->sampleFromInitialRho(0, particlesNew);
+    }
+  }
+  if (useMultipleChains())
+  {
+    runChains(0, particlesNew, parentIndices, logUnnormalisedWeights);
   }
-  for (unsigned int n=particleIndices_(0)+1; n<nParticles_; n++)
+  else
   {
-    this->applyInitialKernel(n, n-1, particlesNew);
+    for (unsigned int n=particleIndices_(0)+1; n<nParticles_; n++)
+    {
+      this->applyInitialKernel(n, n-1, particlesNew);
+    }
   }
   
   
@@ -302,6 +340,8 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
   
 //   std::cout << "compute initial weights" << std::endl;
   
+  // NOTE: as at later time steps, no correction is needed if the pool was 
+  // generated by multiple rho_0-invariant chains (see runChains()).
   computeLogInitialParticleWeights(particlesNew, logUnnormalisedWeights);
   
 //      std::cout << "======================" << (local_ == EHMM_LOCAL_HILBERT) << std::endl;
@@ -401,7 +441,7 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
 
       particlesNew[particleIndices_(t)] = particlePath_[t];
       
-      if (particleIndices_(t) > 0)
+      if (particleIndices_(t) > 0 && !useMultipleChains())
       {
         for (unsigned int n=particleIndices_(t)-1; n != static_cast<unsigned>(-1); n--)
         {
@@ -415,7 +455,10 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
     {
       particleIndices_(t) = 0;
       
-      this->sampleFromRho(t, 0, particlesNew, parentIndices, selfNormalisedWeights_);
+      if (!useMultipleChains())
+      {
+        this->sampleFromRho(t, 0, particlesNew, parentIndices, selfNormalisedWeights_);
+      }
       
       if (local_ == EHMM_LOCAL_HILBERT_AUTOREGRESSIVE || local_ == EHMM_LOCAL_HILBERT_RANDOM_WALK)
       {
@@ -427,7 +470,11 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
     
 //         std::cout << "finished apply kernel 1" << std::endl; 
     
-    if (particleIndices_(t)+1 < nParticles_)
+    if (useMultipleChains())
+    {
+      runChains(t, particlesNew, parentIndices, logUnnormalisedWeights);
+    }
+    else if (particleIndices_(t)+1 < nParticles_)
     {
       for (unsigned int n=particleIndices_(t)+1; n<nParticles_; n++)
       {
@@ -462,6 +509,12 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
 
 //    std::cout << "start compute weights" << std::endl; 
     logUnnormalisedWeights.fill(-std::log(nParticles_)); // resetting the weights
+    // NOTE: if the pool was generated by multiple chains (see runChains()), 
+    // these weights need no correction: the law of each chain's block is 
+    // rho_t-invariant and does not depend on which index within the block 
+    // was conditioned on, and the blocks are independent. Hence, given the 
+    // (uniformly drawn) conditioned index, the joint law of the pool has 
+    // the same form as for a single chain.
     computeLogParticleWeights(t, particlesNew, logUnnormalisedWeights);
     logUnnormalisedWeightsFull_.col(t) = logUnnormalisedWeights;
     
@@ -522,6 +575,68 @@ void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observat
   }
 }
 
+/// Generates the pool of particles at time t from multiple MCMC chains.
+template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class EhmmParameters> 
+void Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, EhmmParameters>::runChains
+(
+  const unsigned int t, 
+  std::vector<Particle>& particlesNew, 
+  arma::uvec& parentIndices, 
+  const arma::colvec& logUnnormalisedWeights
+)
+{
+  const unsigned int nChains = std::min(nChains_, nParticles_);
+  
+  // NOTE: the chains are run sequentially because the kernels draw 
+  // their random numbers from R's (global) generator via arma::randu/randn.
+  for (unsigned int p=0; p<nChains; p++)
+  {
+    // Block of particle indices covered by the pth chain:
+    const unsigned int lb = (p * nParticles_) / nChains;
+    const unsigned int ub = ((p + 1) * nParticles_) / nChains;
+    unsigned int nStart;
+    
+    if (isConditional_ && particleIndices_(t) >= lb && particleIndices_(t) < ub)
+    { // the conditioned particle (and its parent index) has already been set
+      nStart = particleIndices_(t);
+      for (unsigned int n=nStart; n>lb; n--)
+      {
+        if (t == 0)
+        {
+          this->applyInitialKernel(n-1, n, particlesNew);
+        }
+        else
+        {
+          this->applyKernel(t, n-1, n, particlesNew, parentIndices, logUnnormalisedWeights, selfNormalisedWeights_);
+        }
+      }
+    }
+    else
+    {
+      nStart = lb;
+      if (t == 0)
+      {
+        this->sampleFromInitialRho(lb, particlesNew);
+      }
+      else
+      {
+        this->sampleFromRho(t, lb, particlesNew, parentIndices, selfNormalisedWeights_);
+      }
+    }
+    for (unsigned int n=nStart+1; n<ub; n++)
+    {
+      if (t == 0)
+      {
+        this->applyInitialKernel(n, n-1, particlesNew);
+      }
+      else
+      {
+        this->applyKernel(t, n, n-1, particlesNew, parentIndices, logUnnormalisedWeights, selfNormalisedWeights_);
+      }
+    }
+  }
+}
+
 /// Samples a single particle index via backward sampling.
 template <class ModelParameters, class LatentVariable, class LatentPath, class LatentPathRepar, class Observations, class Particle, class Aux, class EhmmParameters> 
 unsigned int Ehmm<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, Observations, Particle, Aux, EhmmParameters>::backwardSampling
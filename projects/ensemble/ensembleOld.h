@@ -152,12 +152,12 @@ private:
   bool isConditional_; // are we using a conditional algorithm?
   double logLikelihoodEstimate_; // estimate of the normalising constant.
   std::vector<std::vector<Particle>> particlesFull_; // (nSteps_, nParticles_)-dimensional: holds all particles
-  arma::mat unnormalisedWeightsFull_; // (nParticles_, nSteps_)-dimensional: holds all unnormalised weight
+  arma::mat logUnnormalisedWeightsFull_; // (nParticles_, nSteps_)-dimensional: holds all log-unnormalised weights
   std::vector<Particle> particlePath_; // single particle path needed for conditional SMC algorithms
   arma::uvec particleIndicesIn_; // particle indices associated with the single input particle path
   arma::uvec particleIndicesOut_; // particle indices associated with the single output particle path
   EnsembleOldParameters ensembleOldParameters_; // holds some additional auxiliary parameters for the algorithm.
-  unsigned int nCores_; // number of cores to use (not currently used)
+  unsigned int nCores_; // number of cores to use for evaluating the weights
   
 };
 
@@ -174,7 +174,10 @@ void EnsembleOld<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, O
   ///////////////////////////////////////////////////////////////////////////
 
   particlesFull_.resize(nSteps_);
-  unnormalisedWeightsFull_.zeros(nParticles_, nSteps_);
+  logUnnormalisedWeightsFull_.set_size(nParticles_, nSteps_);
+  
+  arma::colvec logWeightsAux(nParticles_); // terms of the log-weights which do not depend on the previous particles
+  arma::mat logTransitions(nParticles_, nParticles_); // (m,n)th element: log-transition density from the mth time-(t-1) particle to the nth time-t particle
   
   if (isConditional_) {samplePath_ = true;}
  
@@ -214,11 +217,11 @@ void EnsembleOld<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, O
   // Evaluate the "log-weights"
   for (unsigned int n=0; n<nParticles_; n++)
   {
-    unnormalisedWeightsFull_(n,0) = 
-      std::exp(model_.evaluateLogInitialDensity(particlesFull_[0][n])
+    logUnnormalisedWeightsFull_(n,0) = 
+      model_.evaluateLogInitialDensity(particlesFull_[0][n])
       + model_.evaluateLogObservationDensity(0, particlesFull_[0][n])
       - this->evaluateLogProposalDensity(0, particlesFull_[0][n]) 
-      - std::log(nParticles_));
+      - std::log(nParticles_);
   }
 
   
@@ -256,17 +259,41 @@ void EnsembleOld<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, O
       particlesFull_[t][n] = this->applyKernel(t, particlesFull_[t][n-1]);
     }
     
-    // Evaluate the "log-weights"
+    // Evaluate the "log-weights": the terms which only depend on the nth 
+    // time-t particle are computed once; the sum over the time-(t-1) 
+    // particles is then a log-sum-exp matrix-vector product.
+    #pragma omp parallel for num_threads(std::max(nCores_, 1u)) schedule(static) if(nCores_ > 1)
+    for (unsigned int n=0; n<nParticles_; n++)
+    {
+      logWeightsAux(n) = 
+        model_.evaluateLogObservationDensity(t, particlesFull_[t][n])
+        - this->evaluateLogProposalDensity(t, particlesFull_[t][n]) 
+        - std::log(nParticles_);
+      arma::colvec logTransition(logTransitions.colptr(n), nParticles_, false, true); // writes directly into the nth column
+      model_.evaluateLogTransitionDensity(t, particlesFull_[t][n], particlesFull_[t-1], logTransition);
+    }
+    logTransitions.each_col() += logUnnormalisedWeightsFull_.col(t-1);
+    
+    #pragma omp parallel for num_threads(std::max(nCores_, 1u)) schedule(static) if(nCores_ > 1)
     for (unsigned int n=0; n<nParticles_; n++)
     {
+      const double* logTransition = logTransitions.colptr(n);
+      double logTransitionMax = -std::numeric_limits<double>::infinity();
+      for (unsigned int m=0; m<nParticles_; m++)
+      {
+        logTransitionMax = std::max(logTransitionMax, logTransition[m]);
+      }
+      if (!std::isfinite(logTransitionMax)) // e.g. all transitions have zero density
+      {
+        logUnnormalisedWeightsFull_(n,t) = - std::numeric_limits<double>::infinity();
+        continue;
+      }
+      double sum = 0.0;
       for (unsigned int m=0; m<nParticles_; m++)
       {
-        unnormalisedWeightsFull_(n,t) += unnormalisedWeightsFull_(m,t-1) *
-          std::exp(model_.evaluateLogTransitionDensity(t, particlesFull_[t][n], particlesFull_[t-1][m]) 
-          + model_.evaluateLogObservationDensity(t, particlesFull_[t][n])
-          - this->evaluateLogProposalDensity(t, particlesFull_[t][n]) 
-          - std::log(nParticles_));
+        sum += std::exp(logTransition[m] - logTransitionMax);
       }
+      logUnnormalisedWeightsFull_(n,t) = logWeightsAux(n) + logTransitionMax + std::log(sum);
     }
   }
   
@@ -275,7 +302,7 @@ void EnsembleOld<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, O
   /////////////////////////////////////////////////////////////////////////////
   
   // Updating the estimate of the normalising constant:
-  logLikelihoodEstimate_ = std::log(arma::sum(unnormalisedWeightsFull_.col(nSteps_-1)));
+  normaliseWeights(logUnnormalisedWeightsFull_.col(nSteps_-1), logLikelihoodEstimate_);
 
   
   /////////////////////////////////////////////////////////////////////////////
@@ -339,7 +366,7 @@ void EnsembleOld<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, O
 //     std::cout << "final-time weights: " << arma::trans(arma::log(unnormalisedWeightsFull_.col(nSteps_-1))) << std::endl;
   
   // Final-time particle:
-  particleIndicesOut_(nSteps_-1) = sampleInt(normaliseWeights(arma::log(unnormalisedWeightsFull_.col(nSteps_-1))));
+  particleIndicesOut_(nSteps_-1) = sampleInt(normaliseWeights(logUnnormalisedWeightsFull_.col(nSteps_-1)));
   particlePath_[nSteps_-1]       = particlesFull_[nSteps_-1][particleIndicesOut_(nSteps_-1)];
   
   // Recursion for the particles at previous time steps:
@@ -349,7 +376,7 @@ void EnsembleOld<ModelParameters, LatentVariable, LatentPath, LatentPathRepar, O
     
     for (unsigned int n=0; n<nParticles_; n++)
     {
-      logWeightsAux(n)  = std::log(unnormalisedWeightsFull_(n,t)) + 
+      logWeightsAux(n)  = logUnnormalisedWeightsFull_(n,t) + 
                           model_.evaluateLogTransitionDensity(t+1, particlePath_[t+1], particlesFull_[t][n]);
                           /// NOTE: for more general models than state-space models this needs to be modified!
     }